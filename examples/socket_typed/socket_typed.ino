@@ -0,0 +1,77 @@
+/*
+ * This example sends and receives a socket with a compile time layout
+ * the callback receives a plain structure with the tag values instead of vectors
+ */
+
+#include <Arduino.h>
+
+#if defined(ESP8266)
+#include <ESP8266WiFi.h>
+#elif defined(ESP32)
+#include <WiFi.h>
+#endif
+char ssid[] = "SECRET_SSID"; // your network SSID (name)
+char pass[] = "SECRET_PASS"; // your network password
+
+#include <abus_socket.h>
+abus_socket abSock(8442, 8266);
+
+// layout of the socket: 1 bit, 1 int, 1 long and 1 real tag / variable
+typedef ab_socket_layout<1, 1, 1, 1> plc_socket;
+
+// callback declaration for receiving a socket
+void cbSocketReceived(const plc_socket::data &values, uint32_t sender)
+{
+    Serial.printf("socket from NAD=%u", sender);
+    Serial.printf(",bit0=%d", values.bitdata[0]);
+    Serial.printf(",int0=%d", values.intdata[0]);
+    Serial.printf(",long0=%d", values.longdata[0]);
+    Serial.print(",real0=");
+    Serial.println(values.realdata[0]);
+}
+
+void setup()
+{
+    // put your setup code here, to run once:
+    Serial.begin(115200);
+
+    WiFi.mode(WIFI_STA);
+    // Connect or reconnect to WiFi
+    if (WiFi.status() != WL_CONNECTED)
+    {
+        Serial.print("Attempting to connect to SSID: ");
+        Serial.println(ssid);
+        while (WiFi.status() != WL_CONNECTED)
+        {
+            WiFi.begin(ssid, pass); // Connect to WPA/WPA2 network. Change this line if using open or WEP network
+            Serial.print(".");
+            delay(5000);
+        }
+        Serial.println("\nConnected.");
+    }
+    // initialize the socket function
+    abSock.begin();
+    // add a callback to receive a socket with id: 3 and the layout of plc_socket
+    abSock.setSocketCallback<plc_socket>(3, cbSocketReceived);
+}
+
+uint32_t millis_next = 10000;
+void loop()
+{
+    // put your main code here, to run repeatedly:
+    abSock.loop();
+
+    if (millis() >= millis_next)
+    {
+        // fill the tag values of the socket
+        plc_socket::data values;
+        values.bitdata[0] = true;
+        values.intdata[0] = 123;
+        values.longdata[0] = 123456;
+        values.realdata[0] = 12.3;
+
+        // send the socket with id 3 over wifi to the PLC
+        abSock.sendSocket<plc_socket>(3, values);
+        millis_next = millis() + 10000;
+    }
+}
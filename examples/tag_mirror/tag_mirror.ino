@@ -0,0 +1,93 @@
+/*
+ * This example keeps the latest values of a received socket in a tag mirror instead of copying them in a callback
+ * on the ESP32 a second task reads the values while loop() updates them
+ */
+
+#include <Arduino.h>
+
+#if defined(ESP8266)
+#include <ESP8266WiFi.h>
+#elif defined(ESP32)
+#include <WiFi.h>
+#endif
+char ssid[] = "SECRET_SSID"; // your network SSID (name)
+char pass[] = "SECRET_PASS"; // your network password
+
+#include <abus_socket.h>
+abus_socket abSock(8442, 8266);
+
+// storage for up to 4 sockets with together 8 bit, 8 int, 8 long and 16 real tags
+ab_tag_mirror<4, 8, 8, 8, 16> mirror;
+// handle of the socket with id 7 of the PLC with NAD 1234
+uint8_t plcSocket = 0;
+
+// print the values of the socket if a new frame has been received
+void printValues()
+{
+    static uint32_t lastVersion = 0;
+    ab_fixed_socket values;
+    uint32_t version;
+    // all tags of the snapshot are from the same frame
+    if (mirror.read(plcSocket, values, &version) && version != lastVersion)
+    {
+        lastVersion = version;
+        Serial.printf("socket 7 from NAD=%u (frame %u):", values.sender, version);
+        for (size_t i = 0; i < values.realdata.size(); i++)
+            Serial.printf(" real%u=%.2f", (unsigned)i, values.realdata[i]);
+        Serial.println();
+    }
+}
+
+#if defined(ESP32)
+// reader task, it needs no lock to read the mirror
+void readerTask(void *arg)
+{
+    while (true)
+    {
+        printValues();
+        // a single value can be read directly
+        float_t real3;
+        if (mirror.getReal(plcSocket, 3, real3) && real3 > 100.0)
+            Serial.println("real3 above limit");
+        delay(1000);
+    }
+}
+#endif
+
+void setup()
+{
+    // put your setup code here, to run once:
+    Serial.begin(115200);
+
+    WiFi.mode(WIFI_STA);
+    // Connect or reconnect to WiFi
+    if (WiFi.status() != WL_CONNECTED)
+    {
+        Serial.print("Attempting to connect to SSID: ");
+        Serial.println(ssid);
+        while (WiFi.status() != WL_CONNECTED)
+        {
+            WiFi.begin(ssid, pass); // Connect to WPA/WPA2 network. Change this line if using open or WEP network
+            Serial.print(".");
+            delay(5000);
+        }
+        Serial.println("\nConnected.");
+    }
+    // initialize the socket function
+    abSock.begin();
+    // mirror the socket with id 7 of NAD 1234: 0 bit, 0 int, 0 long and 4 real tags
+    plcSocket = mirror.add(1234, 7, 0, 0, 0, 4);
+    abSock.setMirror(&mirror);
+#if defined(ESP32)
+    xTaskCreate(readerTask, "reader", 4096, NULL, 1, NULL);
+#endif
+}
+
+void loop()
+{
+    // put your main code here, to run repeatedly:
+    abSock.loop();
+#if !defined(ESP32)
+    printValues();
+#endif
+}
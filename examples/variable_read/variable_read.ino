@@ -0,0 +1,171 @@
+/*
+ * This example shows the use of the variable client: several requests are in flight at the same time,
+ * the replies are matched by their transaction id
+ *
+ * NOTE: the library does not contain the variable command layout of a PLC firmware. The codec below is a PLACEHOLDER
+ * layout which a PLC will not answer (every request ends with AB_REQ_TIMEOUT), it only works against a peer which
+ * implements the same layout (e.g. a simulator). Replace its methods with the command layout of your PLC firmware.
+ *
+ * placeholder layout:
+ *   request: header(dir = 0, typ = 0), cmd, count, count * (addr lo, addr hi, size [, value of a write])
+ *   reply:   header(dir = 1, typ = 0), cmd, status, values of a read request in request order (little endian)
+ */
+
+#include <Arduino.h>
+
+#if defined(ESP8266)
+#include <ESP8266WiFi.h>
+#elif defined(ESP32)
+#include <WiFi.h>
+#endif
+char ssid[] = "SECRET_SSID"; // your network SSID (name)
+char pass[] = "SECRET_PASS"; // your network password
+
+#include <abus_client.h>
+
+// PLACEHOLDER command layout, replace it with the one of the PLC firmware
+class placeholder_codec : public ab_client_codec
+{
+public:
+    void requestHeader(ab_header &header) const
+    {
+        header.dir = 0;
+        header.typ = 0;
+    }
+    bool isReply(const ab_header &header) const
+    {
+        return header.dir == 1 && header.typ == 0;
+    }
+    size_t requestLen(uint8_t cmd, const ab_var *vars, uint8_t count) const
+    {
+        size_t retval = 2;
+        for (uint8_t i = 0; i < count; i++)
+            retval += 3 + (cmd == ABCLI_CMD_WRITE ? ab_varSize(vars[i].type) : 0);
+        return retval;
+    }
+    size_t replyLen(uint8_t cmd, const ab_var *vars, uint8_t count) const
+    {
+        size_t retval = 2;
+        for (uint8_t i = 0; i < count && cmd == ABCLI_CMD_READ; i++)
+            retval += ab_varSize(vars[i].type);
+        return retval;
+    }
+    void encodeRequest(char *payload, uint8_t cmd, const ab_var *vars, uint8_t count) const
+    {
+        *payload++ = (char)cmd;
+        *payload++ = (char)count;
+        for (uint8_t i = 0; i < count; i++)
+        {
+            uint8_t size = ab_varSize(vars[i].type);
+            ab_storeU16(payload, vars[i].addr);
+            payload[2] = (char)size;
+            payload += 3;
+            if (cmd != ABCLI_CMD_WRITE)
+                continue;
+            uint32_t raw = ab_getVarRaw(vars[i]);
+            for (uint8_t b = 0; b < size; b++)
+                *payload++ = (char)((raw >> (b * 8)) & 0xFF);
+        }
+    }
+    ab_request_status decodeReply(const char *payload, size_t len, uint8_t cmd, ab_var *vars, uint8_t count, uint8_t &plc_status) const
+    {
+        const uint8_t *p = reinterpret_cast<const uint8_t *>(payload);
+        if (len < 2 || p[0] != cmd)
+            return AB_REQ_INVALID;
+        plc_status = p[1];
+        if (plc_status != 0)
+            return AB_REQ_ERROR;
+        if (cmd != ABCLI_CMD_READ)
+            return AB_REQ_OK;
+        if (len != replyLen(cmd, vars, count))
+            return AB_REQ_INVALID;
+        p += 2;
+        for (uint8_t i = 0; i < count; i++)
+        {
+            uint8_t size = ab_varSize(vars[i].type);
+            uint32_t raw = 0;
+            for (uint8_t b = 0; b < size; b++)
+                raw |= (uint32_t)p[b] << (b * 8);
+            p += size;
+            ab_setVarRaw(vars[i], raw);
+        }
+        return AB_REQ_OK;
+    }
+};
+
+abus_socket abSock(8442, 8266);
+placeholder_codec plcCodec;
+abus_client abClient(abSock, plcCodec);
+
+// NAD of the PLC
+const uint32_t plcNad = 1000;
+// variables which are read cyclic
+ab_var readVars[3];
+// variable which is written cyclic
+ab_var writeVars[1];
+
+// callback declaration for finished requests
+void cbRequestDone(void *ctx, const ab_request_result &result)
+{
+    if (result.status != AB_REQ_OK)
+    {
+        Serial.printf("request %u to NAD=%u failed, status=%d\n", result.id, result.nad, result.status);
+        return;
+    }
+    if (result.cmd == ABCLI_CMD_READ)
+    {
+        Serial.printf("bit=%d, int=%d, real=", result.vars[0].value, result.vars[1].value);
+        Serial.println(result.vars[2].real);
+    }
+}
+
+void setup()
+{
+    // put your setup code here, to run once:
+    Serial.begin(115200);
+
+    WiFi.mode(WIFI_STA);
+    // Connect or reconnect to WiFi
+    if (WiFi.status() != WL_CONNECTED)
+    {
+        Serial.print("Attempting to connect to SSID: ");
+        Serial.println(ssid);
+        while (WiFi.status() != WL_CONNECTED)
+        {
+            WiFi.begin(ssid, pass); // Connect to WPA/WPA2 network. Change this line if using open or WEP network
+            Serial.print(".");
+            delay(5000);
+        }
+        Serial.println("\nConnected.");
+    }
+    // initialize the socket function
+    abSock.begin();
+    // 100ms reply timeout with 2 repetitions
+    abClient.setTimeout(100, 2);
+
+    readVars[0].addr = 0x0400;
+    readVars[0].type = AB_VAR_BIT;
+    readVars[1].addr = 0x0402;
+    readVars[1].type = AB_VAR_INT;
+    readVars[2].addr = 0x0404;
+    readVars[2].type = AB_VAR_REAL;
+    writeVars[0].addr = 0x0408;
+    writeVars[0].type = AB_VAR_LONG;
+}
+
+uint32_t millis_next = 1000;
+void loop()
+{
+    // put your main code here, to run repeatedly:
+    abSock.loop();
+    abClient.loop();
+
+    if (millis() >= millis_next)
+    {
+        // the read and the write request are sent back to back without waiting for the first reply
+        abClient.read(plcNad, readVars, 3, cbRequestDone);
+        writeVars[0].value++;
+        abClient.write(plcNad, writeVars, 1, cbRequestDone);
+        millis_next = millis() + 1000;
+    }
+}
@@ -0,0 +1,417 @@
+/*
+ * Host benchmark of the per packet hot paths of the library (codec, crc and dispatch)
+ * it prints ns/op, MB/s and heap allocations per operation for socket sizes from 1 tag up to a full frame
+ * usage: abus_bench [--filter text] [--min-ms ms] [--save file] [--baseline file] [--tolerance percent]
+ *   --save      writes the results as csv (name,config,ns_per_op)
+ *   --baseline  compares with a saved csv and returns 1 if an operation got slower than the tolerance (default 15%)
+ */
+
+#define ABSOCK_NO_DEBUG
+#define ABSOCK_NO_ERROR
+#define ABUS_NO_ERROR
+#include <abus_socket.h>
+
+#include <chrono>
+#include <map>
+#include <new>
+#include <stdlib.h>
+#include <string>
+
+// heap allocation counter
+static size_t g_allocs = 0;
+void *operator new(size_t size)
+{
+    g_allocs++;
+    void *ptr = malloc(size ? size : 1);
+    if (ptr == NULL)
+        throw std::bad_alloc();
+    return ptr;
+}
+void operator delete(void *ptr) noexcept
+{
+    free(ptr);
+}
+void operator delete(void *ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+// keeps the results of the benchmarked functions alive
+static volatile uint32_t g_sink = 0;
+
+// transport which returns the same frame on every parsePacket() and drops all sent frames
+class bench_transport : public ab_transport
+{
+public:
+    const char *frame = NULL;
+    size_t framelen = 0;
+    size_t remaining = 0; // amount of datagrams parsePacket() returns
+    bool begin(uint16_t) { return true; }
+    void stop() {}
+    int parsePacket()
+    {
+        if (remaining == 0)
+            return 0;
+        remaining--;
+        return (int)framelen;
+    }
+    int read(char *data, size_t len)
+    {
+        if (len > framelen)
+            len = framelen;
+        memcpy(data, frame, len);
+        return (int)len;
+    }
+    IPAddress remoteIP() { return IPAddress(127, 0, 0, 1); }
+    uint16_t remotePort() { return 8442; }
+    bool send(const IPAddress &, uint16_t, const char *data, size_t datalen)
+    {
+        g_sink += (uint8_t)data[datalen - 1];
+        return true;
+    }
+    IPAddress broadcastIP() { return IPAddress(127, 255, 255, 255); }
+    uint32_t defaultNad() { return 8266; }
+};
+
+// socket configuration of a benchmark case
+struct bench_config
+{
+    const char *name;
+    ab_socket_config config;
+};
+
+static ab_socket_config makeConfig(uint8_t bits, uint8_t ints, uint8_t longs, uint8_t reals)
+{
+    ab_socket_config retval;
+    retval.socket_id = 3;
+    retval.bitcount = bits;
+    retval.intcount = ints;
+    retval.longcount = longs;
+    retval.realcount = reals;
+    return retval;
+}
+
+// fill a socket with values of the given configuration
+template <class S>
+static void fillSocket(S &sock, const ab_socket_config &conf)
+{
+    for (uint8_t i = 0; i < conf.bitcount; i++)
+        ab_addBitTag(&sock, i & 1);
+    for (uint8_t i = 0; i < conf.intcount; i++)
+        ab_addIntTag(&sock, -100 * i);
+    for (uint8_t i = 0; i < conf.longcount; i++)
+        ab_addLongTag(&sock, 100000 * i);
+    for (uint8_t i = 0; i < conf.realcount; i++)
+        ab_addRealTag(&sock, 1.5f * i);
+    sock.config.socket_id = conf.socket_id;
+    sock.sender = 1234;
+}
+
+// build a complete and valid socket frame
+static size_t buildFrame(char *frame, size_t framelen, const ab_socket_config &conf)
+{
+    ab_fixed_socket sock;
+    fillSocket(sock, conf);
+    ab_header header;
+    header.dir = 1;
+    header.typ = conf.socket_id;
+    header.from = sock.sender;
+    header.len = ab_getSocketLen(conf);
+    ab_setHeader(frame, framelen, header);
+    ab_setSocket(frame, framelen, sock);
+    ab_setUIntVal(frame, framelen, header.len + 12, ab_calcCRC(frame, header.len + 12));
+    return header.len + 14;
+}
+
+struct bench_result
+{
+    double ns_per_op;
+    double allocs_per_op;
+};
+
+static double g_minMs = 200.0;
+
+/**
+ * run an operation until the minimum time is reached and return the best of 3 runs
+ * @param op operation to measure, returns the amount of operations it did
+ */
+template <class Op>
+static bench_result measure(Op op)
+{
+    // calibration
+    size_t iterations = 1;
+    while (true)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; i++)
+            op();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (ms > g_minMs / 10 || iterations > (1u << 30))
+            break;
+        iterations *= 2;
+    }
+    iterations *= 10;
+    bench_result retval;
+    retval.ns_per_op = 1e300;
+    for (int run = 0; run < 3; run++)
+    {
+        size_t allocs = g_allocs;
+        size_t ops = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; i++)
+            ops += op();
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        if (ns / ops < retval.ns_per_op)
+            retval.ns_per_op = ns / ops;
+        retval.allocs_per_op = (double)(g_allocs - allocs) / ops;
+    }
+    return retval;
+}
+
+struct bench_output
+{
+    std::string filter;
+    std::map<std::string, double> results; // "name,config" -> ns/op
+};
+
+template <class Op>
+static void run(bench_output &out, const char *name, const char *config, size_t bytes, Op op)
+{
+    std::string key = std::string(name) + "," + config;
+    if (!out.filter.empty() && key.find(out.filter) == std::string::npos)
+        return;
+    bench_result res = measure(op);
+    double mbps = bytes > 0 ? bytes / res.ns_per_op * 1e9 / 1e6 : 0.0;
+    printf("%-28s %-14s %5zu %12.1f %10.1f %12.2f\n", name, config, bytes, res.ns_per_op, mbps, res.allocs_per_op);
+    fflush(stdout);
+    out.results[key] = res.ns_per_op;
+}
+
+// codec benchmarks of a socket configuration which is only known at runtime
+static void benchConfig(bench_output &out, const bench_config &bc)
+{
+    const ab_socket_config &conf = bc.config;
+    char frame[MAX_DATA_LEN];
+    size_t framelen = buildFrame(frame, sizeof(frame), conf);
+    ab_header header = ab_getHeader(frame, framelen);
+
+    run(out, "ab_calcCRC", bc.name, framelen - 2, [&]() {
+        g_sink += ab_calcCRC(frame, framelen - 2);
+        return 1;
+    });
+    // incremental calculation in the sections of an encoder (header, dir/typ, tag data, ts_id)
+    run(out, "ab_crcUpdate(sections)", bc.name, framelen - 2, [&]() {
+        ab_crc_state crc;
+        ab_crcInit(crc);
+        ab_crcUpdate(crc, frame, 12);
+        ab_crcUpdate(crc, frame + 12, 2);
+        ab_crcUpdate(crc, frame + 14, framelen - 18);
+        ab_crcUpdate(crc, frame + framelen - 4, 2);
+        g_sink += ab_crcFinal(crc);
+        return 1;
+    });
+    run(out, "ab_checkValidPacket", bc.name, framelen, [&]() {
+        g_sink += ab_checkValidPacket(frame, framelen);
+        return 1;
+    });
+    run(out, "ab_getHeader", bc.name, 14, [&]() {
+        g_sink += ab_getHeader(frame, framelen).len;
+        return 1;
+    });
+    run(out, "ab_getSocket(vector)", bc.name, framelen, [&]() {
+        ab_socket sock = ab_getSocket(frame, framelen, header, conf);
+        g_sink += sock.socket_valid;
+        return 1;
+    });
+    static ab_fixed_socket fixed;
+    run(out, "ab_getSocket(fixed)", bc.name, framelen, [&]() {
+        g_sink += ab_getSocket(frame, framelen, header, conf, fixed);
+        return 1;
+    });
+    run(out, "ab_getSocketView+all", bc.name, framelen, [&]() {
+        ab_socket_view view;
+        uint32_t sum = ab_getSocketView(frame, framelen, header, conf, view);
+        for (uint8_t i = 0; i < conf.bitcount; i++)
+            sum += view.bit(i);
+        for (uint8_t i = 0; i < conf.intcount; i++)
+            sum += view.i16(i);
+        for (uint8_t i = 0; i < conf.longcount; i++)
+            sum += view.i32(i);
+        for (uint8_t i = 0; i < conf.realcount; i++)
+            sum += (uint32_t)view.real(i);
+        g_sink += sum;
+        return 1;
+    });
+    ab_socket vsock;
+    fillSocket(vsock, conf);
+    char txbuf[MAX_DATA_LEN];
+    run(out, "ab_setSocket(vector)", bc.name, framelen, [&]() {
+        ab_setSocket(txbuf, sizeof(txbuf), vsock);
+        g_sink += txbuf[14];
+        return 1;
+    });
+    ab_fixed_socket fsock;
+    fillSocket(fsock, conf);
+    run(out, "ab_setSocket(fixed)", bc.name, framelen, [&]() {
+        ab_setSocket(txbuf, sizeof(txbuf), fsock);
+        g_sink += txbuf[14];
+        return 1;
+    });
+    // complete frame with header and crc
+    run(out, "ab_encodeSocket(fixed)", bc.name, framelen, [&]() {
+        g_sink += ab_encodeSocket(txbuf, sizeof(txbuf), fsock, 8266);
+        return 1;
+    });
+
+    bench_transport transport;
+    transport.frame = frame;
+    transport.framelen = framelen;
+    abus_socket sock(transport, 8442, 8266);
+    sock.begin();
+    // queue the frame and hand it to the transport
+    run(out, "sendSocket+flush(fixed)", bc.name, framelen, [&]() {
+        sock.sendSocket(fsock);
+        return sock.flush();
+    });
+    // dispatch through loop() with callbacks on other socket ids in the dispatch table
+    for (uint8_t id = 10; id < 10 + ABSOCK_MAX_SOCKETS / 2; id++)
+        sock.setSocketCallback(id, 1, 0, 0, 0, (SubscribeCallbackAbSocketView)[](const ab_socket_view &v) { g_sink += v.bit(0); });
+    uint8_t handle = sock.setSocketCallback(conf, (SubscribeCallbackAbFixedSocket)[](const ab_fixed_socket &s) { g_sink += s.config.bitcount; });
+    run(out, "loop(fixed cb)", bc.name, framelen, [&]() {
+        transport.remaining = 64;
+        return sock.loop(0).handled;
+    });
+    sock.removeSocketCallback(handle);
+    handle = sock.setSocketCallback(conf, (SubscribeCallbackAbSocketView)[](const ab_socket_view &v) { g_sink += v.bit(0); });
+    run(out, "loop(view cb)", bc.name, framelen, [&]() {
+        transport.remaining = 64;
+        return sock.loop(0).handled;
+    });
+    sock.removeSocketCallback(handle);
+    handle = sock.setSocketCallback(conf, (SubscribeCallbackAbSocket)[](ab_socket s) { g_sink += s.config.bitcount; });
+    run(out, "loop(vector cb)", bc.name, framelen, [&]() {
+        transport.remaining = 64;
+        return sock.loop(0).handled;
+    });
+}
+
+// codec benchmarks of a socket layout which is known at compile time
+template <class Layout>
+static void benchLayout(bench_output &out, const char *name)
+{
+    char frame[MAX_DATA_LEN];
+    size_t framelen = buildFrame(frame, sizeof(frame), Layout::config(3));
+    typename Layout::data values = typename Layout::data();
+    run(out, "layout::decode", name, framelen, [&]() {
+        Layout::decode(frame, values);
+        g_sink += values.bitdata.empty() ? 0 : values.bitdata[0];
+        return 1;
+    });
+    char txbuf[MAX_DATA_LEN];
+    run(out, "layout::encode", name, framelen, [&]() {
+        Layout::encode(txbuf, values);
+        g_sink += txbuf[Layout::frame_len - 5];
+        return 1;
+    });
+    run(out, "ab_encodeSocket(layout)", name, framelen, [&]() {
+        g_sink += ab_encodeSocket<Layout>(txbuf, sizeof(txbuf), 3, values, 8266);
+        return 1;
+    });
+}
+
+static bool loadBaseline(const char *file, std::map<std::string, double> &baseline)
+{
+    FILE *f = fopen(file, "r");
+    if (f == NULL)
+        return false;
+    char line[256];
+    while (fgets(line, sizeof(line), f) != NULL)
+    {
+        char *last = strrchr(line, ',');
+        if (last == NULL)
+            continue;
+        *last = 0;
+        baseline[line] = atof(last + 1);
+    }
+    fclose(f);
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    bench_output out;
+    const char *saveFile = NULL;
+    const char *baselineFile = NULL;
+    double tolerance = 15.0;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc)
+            out.filter = argv[++i];
+        else if (arg == "--min-ms" && i + 1 < argc)
+            g_minMs = atof(argv[++i]);
+        else if (arg == "--save" && i + 1 < argc)
+            saveFile = argv[++i];
+        else if (arg == "--baseline" && i + 1 < argc)
+            baselineFile = argv[++i];
+        else if (arg == "--tolerance" && i + 1 < argc)
+            tolerance = atof(argv[++i]);
+        else
+        {
+            fprintf(stderr, "usage: %s [--filter text] [--min-ms ms] [--save file] [--baseline file] [--tolerance percent]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    const bench_config configs[] = {
+        {"1tag", makeConfig(1, 0, 0, 0)},
+        {"1b1i1l1r", makeConfig(1, 1, 1, 1)},
+        {"4b4i4l4r", makeConfig(4, 4, 4, 4)},
+        {"16b8i8l8r", makeConfig(16, 8, 8, 8)},
+        {"full-real", makeConfig(1, 0, 0, AB_MAX_SOCKET_DATA / 4)},
+        {"full-bit", makeConfig(AB_MAX_SOCKET_DATA, 0, 0, 0)},
+    };
+
+    printf("%-28s %-14s %5s %12s %10s %12s\n", "operation", "socket", "bytes", "ns/op", "MB/s", "allocs/op");
+    for (size_t i = 0; i < sizeof(configs) / sizeof(configs[0]); i++)
+        benchConfig(out, configs[i]);
+    benchLayout<ab_socket_layout<1, 1, 1, 1>>(out, "1b1i1l1r");
+    benchLayout<ab_socket_layout<16, 8, 8, 8>>(out, "16b8i8l8r");
+    benchLayout<ab_socket_layout<1, 0, 0, AB_MAX_SOCKET_DATA / 4>>(out, "full-real");
+
+    if (saveFile != NULL)
+    {
+        FILE *f = fopen(saveFile, "w");
+        if (f == NULL)
+        {
+            fprintf(stderr, "cannot write %s\n", saveFile);
+            return 2;
+        }
+        for (std::map<std::string, double>::const_iterator it = out.results.begin(); it != out.results.end(); ++it)
+            fprintf(f, "%s,%.2f\n", it->first.c_str(), it->second);
+        fclose(f);
+    }
+    int retval = 0;
+    if (baselineFile != NULL)
+    {
+        std::map<std::string, double> baseline;
+        if (!loadBaseline(baselineFile, baseline))
+        {
+            fprintf(stderr, "cannot read %s\n", baselineFile);
+            return 2;
+        }
+        printf("\ncompared with %s (tolerance %.0f%%):\n", baselineFile, tolerance);
+        for (std::map<std::string, double>::const_iterator it = out.results.begin(); it != out.results.end(); ++it)
+        {
+            std::map<std::string, double>::const_iterator base = baseline.find(it->first);
+            if (base == baseline.end() || base->second <= 0)
+                continue;
+            double change = (it->second / base->second - 1.0) * 100.0;
+            bool regression = change > tolerance;
+            if (regression)
+                retval = 1;
+            printf("%-44s %10.1f -> %10.1f ns/op %+7.1f%%%s\n", it->first.c_str(), base->second, it->second, change, regression ? "  REGRESSION" : "");
+        }
+    }
+    return retval;
+}
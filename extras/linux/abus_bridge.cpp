@@ -0,0 +1,99 @@
+/*
+ * This tool receives sockets on a Linux gateway and streams them to local processes (see abus_bridge.h)
+ * every subscriber has its own bounded queue, a slow subscriber loses its oldest messages instead of delaying the receiving
+ * usage: abus_bridge [-i interface] [-n nad] [-p port] [-u path] [-f json|binary] -s id:bits:ints:longs:reals [-s ...]
+ *   -i  network interface of the udp transport
+ *   -n  own NAD
+ *   -p  accept subscribers on this TCP port (127.0.0.1)
+ *   -u  accept subscribers on this Unix socket path
+ *   -f  initial format of the subscribers (default: binary)
+ *   -s  forward a socket id with the given layout
+ * a subscriber can send "sub <id> <nad>", "unsub" and "format json|binary" lines, e.g.
+ *   (echo "format json"; echo "sub 3 0"; cat) | nc 127.0.0.1 8443
+ */
+
+#include <abus_socket.h>
+#include <abus_bridge.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+int main(int argc, char *argv[])
+{
+    const char *interface = NULL;
+    unsigned long nad = 0;
+    ab_bridge_format format = AB_BRIDGE_BINARY;
+    ab_bridge bridge;
+    bool listening = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "i:n:p:u:f:s:")) != -1)
+    {
+        unsigned int id, bits, ints, longs, reals;
+        switch (opt)
+        {
+        case 'i':
+            interface = optarg;
+            break;
+        case 'n':
+            nad = strtoul(optarg, NULL, 10);
+            break;
+        case 'p':
+            if (!bridge.listenTcp((uint16_t)strtoul(optarg, NULL, 10), format))
+            {
+                fprintf(stderr, "can not listen on port %s\n", optarg);
+                return 1;
+            }
+            listening = true;
+            break;
+        case 'u':
+            if (!bridge.listenUnix(optarg, format))
+            {
+                fprintf(stderr, "can not listen on %s\n", optarg);
+                return 1;
+            }
+            listening = true;
+            break;
+        case 'f':
+            format = strcmp(optarg, "json") == 0 ? AB_BRIDGE_JSON : AB_BRIDGE_BINARY;
+            break;
+        case 's':
+            if (sscanf(optarg, "%u:%u:%u:%u:%u", &id, &bits, &ints, &longs, &reals) != 5 || id == 0 || id > 255 ||
+                bits > 255 || ints > 255 || longs > 255 || reals > 255 || !bridge.addSocket(id, bits, ints, longs, reals))
+            {
+                fprintf(stderr, "invalid socket %s\n", optarg);
+                return 1;
+            }
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-i interface] [-n nad] [-p port] [-u path] [-f json|binary] -s id:bits:ints:longs:reals [-s ...]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (!listening)
+    {
+        fprintf(stderr, "no -p or -u given\n");
+        return 1;
+    }
+
+    ab_posix_transport transport(interface);
+    abus_socket abSock(transport, 8442, nad);
+    // only errors, the frames of the bus are not printed one by one
+    abSock.setLogLevel(AB_LOG_ERROR);
+    abSock.setMirror(&bridge);
+    abSock.begin();
+
+    pollfd fds[1 + ABBRIDGE_MAX_LISTENERS + ABBRIDGE_MAX_CLIENTS];
+    while (true)
+    {
+        // wait for received datagrams, new subscribers, their commands or free space in their send buffers
+        fds[0].fd = transport.fd();
+        fds[0].events = POLLIN;
+        fds[0].revents = 0;
+        size_t count = 1 + bridge.pollFds(fds + 1, ABBRIDGE_MAX_LISTENERS + ABBRIDGE_MAX_CLIENTS);
+        poll(fds, count, 1000);
+        // the received sockets are only queued, the subscribers are served afterwards
+        abSock.loop(0);
+        bridge.loop();
+    }
+    return 0;
+}
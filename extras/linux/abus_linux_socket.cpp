@@ -0,0 +1,66 @@
+/*
+ * This example sends and receives a socket on a Linux host with the posix udp transport
+ * it is the Linux counterpart of the socket_send_receive example
+ * usage: abus_linux_socket [interface] [nad] [capture-file]
+ * with a capture file all received and sent frames are recorded for abus_replay
+ */
+
+#include <abus_socket.h>
+#include <poll.h>
+#include <stdlib.h>
+
+// callback declaration for receiving a socket
+void cbSocketReceived(const ab_socket_view &sock)
+{
+    printf("socket ID=%d from NAD=%u: bit0=%d, int0=%d, long0=%d, real0=%.2f\n", sock.config.socket_id, sock.sender,
+           sock.bit(0), sock.i16(0), sock.i32(0), sock.real(0));
+}
+
+int main(int argc, char *argv[])
+{
+    ab_posix_transport transport(argc > 1 ? argv[1] : NULL);
+    abus_socket abSock(transport, 8442, argc > 2 ? strtoul(argv[2], NULL, 10) : 0);
+
+    // record all frames into the capture file
+    FILE *captureFile = argc > 3 ? fopen(argv[3], "wb") : NULL;
+    ab_capture_file capture(captureFile);
+    if (captureFile != NULL)
+        abSock.setCapture(&capture);
+
+    // initialize the socket function
+    abSock.begin();
+    // add a callback to receive a socket with id: 3 and 1 bit, 1 int, 1 long, 1 real tag / variable
+    abSock.setSocketCallback(3, 1, 1, 1, 1, cbSocketReceived);
+
+    uint32_t millis_next = millis();
+    while (true)
+    {
+        // wait for received datagrams or the next send time
+        pollfd pfd;
+        pfd.fd = transport.fd();
+        pfd.events = POLLIN;
+        int32_t timeout = (int32_t)(millis_next - millis());
+        poll(&pfd, 1, timeout > 0 ? timeout : 0);
+        // handle all queued datagrams
+        abSock.loop(0);
+        if (captureFile != NULL)
+            fflush(captureFile);
+
+        if ((int32_t)(millis() - millis_next) >= 0)
+        {
+            // define a new socket object
+            ab_fixed_socket sock;
+            ab_addBitTag(&sock, true);
+            ab_addIntTag(&sock, 123);
+            ab_addLongTag(&sock, 123456);
+            ab_addRealTag(&sock, 12.3);
+            // set the socket id for sending it
+            sock.config.socket_id = 3;
+
+            // send the socket to the PLCs
+            abSock.sendSocket(sock);
+            millis_next = millis() + 10000;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,146 @@
+/*
+ * This tool replays a capture (see abus_capture.h) through the receive path of abus_socket on a Linux host
+ * it prints the throughput, the receive counters and a digest of all callback values, so two builds can be compared
+ * with the same capture without PLCs
+ * usage: abus_replay [-t] [-r repeat] [-d entries] [-c schema.csv] -s id:bits:ints:longs:reals [-s ...] capture-file
+ *   -t  replay with the captured timing (default: as fast as possible)
+ *   -r  replay the capture repeat times
+ *   -d  drop duplicated and late socket frames by their ts_id (table with the given amount of entries)
+ *   -c  register a callback for all sockets of a socket definition file (see abus_schema.h)
+ *   -s  register a callback for a socket id with the given layout
+ */
+
+#include <abus_replay.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <memory>
+
+static uint32_t g_calls = 0;
+static uint64_t g_digest = 14695981039346656037ull;
+
+// FNV-1a digest of a value
+static void digest(uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        g_digest ^= (uint8_t)(value >> (i * 8));
+        g_digest *= 1099511628211ull;
+    }
+}
+
+// callback for all registered sockets: adds the sender and all tag values to the digest
+void cbSocketReceived(const ab_socket_view &sock)
+{
+    g_calls++;
+    digest(sock.config.socket_id);
+    digest(sock.sender);
+    for (uint8_t i = 0; i < sock.config.bitcount; i++)
+        digest(sock.bit(i));
+    for (uint8_t i = 0; i < sock.config.intcount; i++)
+        digest((uint16_t)sock.i16(i));
+    for (uint8_t i = 0; i < sock.config.longcount; i++)
+        digest((uint32_t)sock.i32(i));
+    for (uint8_t i = 0; i < sock.config.realcount; i++)
+    {
+        float_t value = sock.real(i);
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        digest(bits);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    // the transport is not opened, frames sent by callbacks are counted as failed
+    ab_posix_transport transport;
+    abus_socket abSock(transport, 8442, 1);
+    abSock.setLogLevel(AB_LOG_NONE);
+    ab_replay_mode mode = AB_REPLAY_FAST;
+    unsigned long repeat = 1;
+    std::vector<ab_dedup_entry> dedupBuf;
+    std::unique_ptr<ab_dedup> dedup;
+    ab_schema schema;
+    int opt;
+    while ((opt = getopt(argc, argv, "tr:d:c:s:")) != -1)
+    {
+        unsigned int id, bits, ints, longs, reals;
+        switch (opt)
+        {
+        case 't':
+            mode = AB_REPLAY_TIMED;
+            break;
+        case 'r':
+            repeat = strtoul(optarg, NULL, 10);
+            break;
+        case 'd':
+            dedupBuf.resize(strtoul(optarg, NULL, 10));
+            if (dedupBuf.empty() || dedupBuf.size() > 32768)
+            {
+                fprintf(stderr, "invalid table size %s\n", optarg);
+                return 1;
+            }
+            dedup.reset(new ab_dedup(dedupBuf.data(), (uint16_t)dedupBuf.size()));
+            abSock.setDedup(dedup.get());
+            break;
+        case 'c':
+            if (!schema.loadFile(optarg) || abSock.setSocketCallbacks(schema.sockets(), schema.socketCount(), cbSocketReceived) == 0)
+            {
+                fprintf(stderr, "invalid schema %s (line %u)\n", optarg, schema.errorLine());
+                return 1;
+            }
+            break;
+        case 's':
+            if (sscanf(optarg, "%u:%u:%u:%u:%u", &id, &bits, &ints, &longs, &reals) != 5 || id == 0 || id > 255 ||
+                abSock.setSocketCallback(id, bits, ints, longs, reals, cbSocketReceived) == 0)
+            {
+                fprintf(stderr, "invalid socket %s\n", optarg);
+                return 1;
+            }
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-t] [-r repeat] [-d entries] [-c schema.csv] -s id:bits:ints:longs:reals [-s ...] capture-file\n", argv[0]);
+            return 1;
+        }
+    }
+    if (optind >= argc)
+    {
+        fprintf(stderr, "no capture file\n");
+        return 1;
+    }
+    FILE *file = fopen(argv[optind], "rb");
+    if (file == NULL)
+    {
+        fprintf(stderr, "can not open %s\n", argv[optind]);
+        return 1;
+    }
+
+    ab_replay_result total;
+    for (unsigned long i = 0; i < repeat; i++)
+    {
+        rewind(file);
+        ab_capture_file_reader reader(file);
+        if (!reader.valid())
+        {
+            fprintf(stderr, "%s is no capture file\n", argv[optind]);
+            fclose(file);
+            return 1;
+        }
+        ab_replay_result result = ab_replay(abSock, reader, mode);
+        total.frames += result.frames;
+        total.bytes += result.bytes;
+        total.skipped += result.skipped;
+        total.truncated += result.truncated;
+        total.micros += result.micros;
+    }
+    fclose(file);
+
+    ab_stats stats = abSock.getStats();
+    printf("frames: %u (%u bytes, %u sent frames skipped, %u truncated frames skipped) in %.3f s, %.0f frames/s\n", total.frames,
+           total.bytes, total.skipped, total.truncated, total.micros / 1e6, total.micros > 0 ? total.frames * 1e6 / total.micros : 0.0);
+    printf("dropped: short %u, magic %u, length %u, crc %u, oversized %u\n", stats.rx.bad_short, stats.rx.bad_magic,
+           stats.rx.bad_length, stats.rx.bad_crc, stats.rx.oversized);
+    printf("dispatch: hits %u, misses %u, other %u, duplicate %u, stale %u\n", stats.rx.hits, stats.rx.misses, stats.rx.other,
+           stats.rx.duplicate, stats.rx.stale);
+    printf("callbacks: %u, digest %016llx\n", g_calls, (unsigned long long)g_digest);
+    return 0;
+}
@@ -0,0 +1,592 @@
+/**
+ * abus_bridge.h
+ * Purpose: fan out the received sockets of abus_socket to local TCP or Unix socket subscribers (Linux gateway),
+ * as compact binary records or as newline delimited JSON, every subscriber with its own bounded queue
+
+ * @author Daniel Gangl
+ */
+#ifndef _ABUS_BRIDGE_H_
+#define _ABUS_BRIDGE_H_
+
+#include <abus_tag_mirror.h>
+
+#if !defined(ARDUINO)
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+// maximum amount of connected subscribers
+#ifndef ABBRIDGE_MAX_CLIENTS
+#define ABBRIDGE_MAX_CLIENTS 16
+#endif
+// maximum amount of listening sockets
+#ifndef ABBRIDGE_MAX_LISTENERS
+#define ABBRIDGE_MAX_LISTENERS 4
+#endif
+// queue size per subscriber in bytes, the oldest messages are dropped if a new one does not fit
+#ifndef ABBRIDGE_QUEUE_BYTES
+#define ABBRIDGE_QUEUE_BYTES 65536
+#endif
+// queue size per subscriber in messages
+#ifndef ABBRIDGE_QUEUE_LEN
+#define ABBRIDGE_QUEUE_LEN 1024
+#endif
+// subscription filters per subscriber
+#ifndef ABBRIDGE_MAX_FILTERS
+#define ABBRIDGE_MAX_FILTERS 8
+#endif
+// bytes which are handed to the kernel with one send()
+#define ABBRIDGE_SEND_CHUNK 16384
+// maximum length of a command line of a subscriber
+#define ABBRIDGE_LINE_LEN 128
+// length of the header of a binary record
+#define ABBRIDGE_RECORD_LEN 18
+
+/*
+ * binary record (all values little endian):
+ *   len(2, whole record) id(1) bitcount(1) intcount(1) longcount(1) realcount(1) 0 nad(4) ts_id(2) time(4, ms),
+ *   followed by the tag data in the layout of the frame (bits one byte each, ints, longs, reals)
+ * JSON line:
+ *   {"id":3,"nad":1234,"ts":17,"time":5000,"bits":[1],"ints":[-5],"longs":[70000],"reals":[1.5]}
+ * commands of a subscriber (text lines):
+ *   sub <socket id> <nad>   receive only matching sockets (0 = any), up to ABBRIDGE_MAX_FILTERS filters
+ *   unsub                   remove all filters (= receive all sockets)
+ *   format json|binary      change the format of the following messages
+ */
+
+// format of the messages to a subscriber
+enum ab_bridge_format : uint8_t
+{
+    AB_BRIDGE_BINARY = 0, // binary records
+    AB_BRIDGE_JSON = 1,   // newline delimited JSON
+};
+
+// counters of a bridge
+struct ab_bridge_stats
+{
+    uint32_t clients = 0;  // connected subscribers
+    uint32_t accepted = 0; // accepted connections
+    uint32_t rejected = 0; // connections rejected because of ABBRIDGE_MAX_CLIENTS
+    uint32_t queued = 0;   // messages added to the subscriber queues
+    uint32_t dropped = 0;  // messages dropped by full subscriber queues (oldest first)
+    uint64_t bytes = 0;    // bytes sent to the subscribers
+};
+
+/**
+ * bridge of received sockets to local subscribers, attach it with abus_socket::setMirror()
+ * the receive path only copies a message into the queues of the matching subscribers, all network
+ * writes are non-blocking and happen in loop(), so a slow subscriber loses its oldest messages
+ * instead of delaying the udp receiving
+ * update() and loop() have to be called from the same thread (the thread which calls abus_socket::loop())
+ * usage:
+ *   ab_bridge bridge;
+ *   bridge.addSocket(3, 1, 1, 1, 1);
+ *   bridge.listenTcp(8443, AB_BRIDGE_JSON);
+ *   abSock.setMirror(&bridge);
+ *   while (true) { abSock.loop(0); bridge.loop(); }
+ */
+class ab_bridge : public ab_mirror_target
+{
+public:
+    ab_bridge()
+    {
+        memset(m_head, AB_MIRROR_NONE, sizeof(m_head));
+        for (uint8_t i = 0; i < ABBRIDGE_MAX_LISTENERS; i++)
+            m_listeners[i].fd = -1;
+    }
+    ~ab_bridge()
+    {
+        for (uint8_t i = 0; i < ABBRIDGE_MAX_CLIENTS; i++)
+            disconnect(m_clients[i]);
+        for (uint8_t i = 0; i < ABBRIDGE_MAX_LISTENERS; i++)
+        {
+            if (m_listeners[i].fd < 0)
+                continue;
+            close(m_listeners[i].fd);
+            if (!m_listeners[i].path.empty())
+                unlink(m_listeners[i].path.c_str());
+        }
+    }
+    /**
+     * forward a socket layout to the subscribers, frames of other layouts are not forwarded
+     * @param sock_id socket id
+     * @param bitcount amount of bit tags
+     * @param intcount amount of int tags
+     * @param longcount amount of long tags
+     * @param realcount amount of real tags
+     * @return true = added
+     */
+    bool addSocket(uint8_t sock_id, uint8_t bitcount, uint8_t intcount, uint8_t longcount, uint8_t realcount)
+    {
+        ab_socket_config config;
+        config.socket_id = sock_id;
+        config.bitcount = bitcount;
+        config.intcount = intcount;
+        config.longcount = longcount;
+        config.realcount = realcount;
+        if (sock_id == 0 || m_configs.size() >= AB_MIRROR_NONE || ab_getSocketLen(config) == 4)
+            return false;
+        // several layouts of one socket id are chained like the callbacks of abus_socket
+        m_next.push_back(m_head[sock_id]);
+        m_head[sock_id] = (uint8_t)m_configs.size();
+        m_configs.push_back(config);
+        return true;
+    }
+    /**
+     * pass the frames on to another receiver as well (e.g. a tag mirror)
+     * @param next receiver of the frames (NULL = none)
+     */
+    void setNext(ab_mirror_target *next)
+    {
+        m_nextTarget = next;
+    }
+    /**
+     * accept subscribers on a TCP port
+     * @param port TCP port
+     * @param format initial message format of the subscribers
+     * @param addr local ipv4 address (default: only local processes)
+     * @return true = listening
+     */
+    bool listenTcp(uint16_t port, ab_bridge_format format = AB_BRIDGE_BINARY, const char *addr = "127.0.0.1")
+    {
+        sockaddr_in sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sin_family = AF_INET;
+        sa.sin_port = htons(port);
+        if (inet_pton(AF_INET, addr, &sa.sin_addr) != 1)
+            return false;
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0)
+            return false;
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        return addListener(fd, reinterpret_cast<sockaddr *>(&sa), sizeof(sa), format, NULL);
+    }
+    /**
+     * accept subscribers on a Unix domain socket, an existing file of the path is replaced
+     * @param path file system path of the socket
+     * @param format initial message format of the subscribers
+     * @return true = listening
+     */
+    bool listenUnix(const char *path, ab_bridge_format format = AB_BRIDGE_BINARY)
+    {
+        sockaddr_un sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sun_family = AF_UNIX;
+        if (strlen(path) >= sizeof(sa.sun_path))
+            return false;
+        strcpy(sa.sun_path, path);
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+            return false;
+        unlink(path);
+        return addListener(fd, reinterpret_cast<sockaddr *>(&sa), sizeof(sa), format, path);
+    }
+    bool update(const char *frame, size_t len, const ab_header &header) override
+    {
+        bool retval = false;
+        for (uint8_t pos = m_head[header.typ]; pos != AB_MIRROR_NONE; pos = m_next[pos])
+        {
+            ab_socket_view view;
+            if (ab_getSocketLen(m_configs[pos]) != header.len || !ab_getSocketView(frame, len, header, m_configs[pos], view))
+                continue;
+            publish(view, header.ts_id);
+            retval = true;
+            break;
+        }
+        if (m_nextTarget != NULL && m_nextTarget->update(frame, len, header))
+            retval = true;
+        return retval;
+    }
+    /**
+     * accept new subscribers, read their commands and send the queued messages (non-blocking)
+     */
+    void loop()
+    {
+        for (uint8_t i = 0; i < ABBRIDGE_MAX_LISTENERS; i++)
+        {
+            if (m_listeners[i].fd >= 0)
+                accept(m_listeners[i]);
+        }
+        for (uint8_t i = 0; i < ABBRIDGE_MAX_CLIENTS; i++)
+        {
+            ab_bridge_client &client = m_clients[i];
+            if (client.fd < 0)
+                continue;
+            if (readCommands(client))
+                flush(client);
+        }
+    }
+    /**
+     * file descriptors to wait for with poll() before the next loop()
+     * @param fds receives the file descriptors and events
+     * @param max size of fds
+     * @return amount of entries
+     */
+    size_t pollFds(pollfd *fds, size_t max) const
+    {
+        size_t retval = 0;
+        for (uint8_t i = 0; i < ABBRIDGE_MAX_LISTENERS && retval < max; i++)
+        {
+            if (m_listeners[i].fd < 0)
+                continue;
+            fds[retval].fd = m_listeners[i].fd;
+            fds[retval].events = POLLIN;
+            fds[retval++].revents = 0;
+        }
+        for (uint8_t i = 0; i < ABBRIDGE_MAX_CLIENTS && retval < max; i++)
+        {
+            const ab_bridge_client &client = m_clients[i];
+            if (client.fd < 0)
+                continue;
+            fds[retval].fd = client.fd;
+            fds[retval].events = POLLIN | (client.pending() ? POLLOUT : 0);
+            fds[retval++].revents = 0;
+        }
+        return retval;
+    }
+    /**
+     * @return counters of the bridge
+     */
+    const ab_bridge_stats &getStats() const
+    {
+        return m_stats;
+    }
+
+private:
+    // listening socket
+    struct ab_bridge_listener
+    {
+        int fd;
+        ab_bridge_format format;
+        std::string path; // path of a Unix socket (empty = TCP)
+    };
+    // subscription filter
+    struct ab_bridge_filter
+    {
+        uint8_t sock_id; // 0 = any
+        uint32_t nad;    // 0 = any
+    };
+    // connected subscriber with its message queue
+    struct ab_bridge_client
+    {
+        int fd = -1;
+        ab_bridge_format format = AB_BRIDGE_BINARY;
+        ab_bridge_filter filters[ABBRIDGE_MAX_FILTERS];
+        uint8_t filterCount = 0;     // 0 = all sockets
+        std::vector<char> ring;      // queued messages (ABBRIDGE_QUEUE_BYTES)
+        uint32_t lens[ABBRIDGE_QUEUE_LEN];
+        uint32_t ringHead = 0;       // first byte of the oldest message
+        uint32_t ringUsed = 0;       // queued bytes
+        uint16_t lenHead = 0;        // length of the oldest message
+        uint16_t count = 0;          // queued messages
+        std::vector<char> out;       // whole messages taken from the queue, being sent
+        size_t outPos = 0;           // sent bytes of out
+        std::string line;            // incomplete command line
+        bool pending() const
+        {
+            return count > 0 || outPos < out.size();
+        }
+    };
+
+    std::vector<ab_socket_config> m_configs; // forwarded socket layouts
+    std::vector<uint8_t> m_next;             // next layout with the same socket id
+    uint8_t m_head[256];                     // first layout per socket id
+    ab_mirror_target *m_nextTarget = NULL;   // chained receiver of the frames
+    ab_bridge_listener m_listeners[ABBRIDGE_MAX_LISTENERS];
+    ab_bridge_client m_clients[ABBRIDGE_MAX_CLIENTS];
+    ab_bridge_stats m_stats;
+    std::vector<char> m_binary; // binary record of the current frame
+    std::string m_json;         // JSON line of the current frame
+
+    bool addListener(int fd, const sockaddr *sa, socklen_t salen, ab_bridge_format format, const char *path)
+    {
+        for (uint8_t i = 0; i < ABBRIDGE_MAX_LISTENERS; i++)
+        {
+            if (m_listeners[i].fd >= 0)
+                continue;
+            if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK) < 0 || bind(fd, sa, salen) < 0 || listen(fd, 8) < 0)
+                break;
+            m_listeners[i].fd = fd;
+            m_listeners[i].format = format;
+            m_listeners[i].path = path != NULL ? path : "";
+            return true;
+        }
+        close(fd);
+        return false;
+    }
+    void accept(ab_bridge_listener &listener)
+    {
+        int fd;
+        while ((fd = ::accept(listener.fd, NULL, NULL)) >= 0)
+        {
+            ab_bridge_client *client = NULL;
+            for (uint8_t i = 0; i < ABBRIDGE_MAX_CLIENTS && client == NULL; i++)
+            {
+                if (m_clients[i].fd < 0)
+                    client = &m_clients[i];
+            }
+            if (client == NULL || fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK) < 0)
+            {
+                close(fd);
+                m_stats.rejected++;
+                continue;
+            }
+            client->fd = fd;
+            client->format = listener.format;
+            client->filterCount = 0;
+            client->ring.resize(ABBRIDGE_QUEUE_BYTES);
+            client->ringHead = client->ringUsed = 0;
+            client->lenHead = client->count = 0;
+            client->out.clear();
+            client->outPos = 0;
+            client->line.clear();
+            m_stats.accepted++;
+            m_stats.clients++;
+        }
+    }
+    void disconnect(ab_bridge_client &client)
+    {
+        if (client.fd < 0)
+            return;
+        close(client.fd);
+        client.fd = -1;
+        client.count = 0;
+        client.ringUsed = 0;
+        client.out.clear();
+        client.outPos = 0;
+        m_stats.clients--;
+    }
+    /**
+     * read and execute the commands of a subscriber
+     * @return false = subscriber disconnected
+     */
+    bool readCommands(ab_bridge_client &client)
+    {
+        char buf[256];
+        while (true)
+        {
+            ssize_t len = recv(client.fd, buf, sizeof(buf), MSG_DONTWAIT);
+            if (len < 0 && errno == EINTR)
+                continue;
+            if (len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                return true;
+            if (len <= 0)
+            {
+                disconnect(client);
+                return false;
+            }
+            for (ssize_t i = 0; i < len; i++)
+            {
+                if (buf[i] != '\n')
+                {
+                    // an overlong line is ignored
+                    if (client.line.size() <= ABBRIDGE_LINE_LEN)
+                        client.line += buf[i];
+                    continue;
+                }
+                if (client.line.size() <= ABBRIDGE_LINE_LEN)
+                    command(client, client.line.c_str());
+                client.line.clear();
+            }
+        }
+    }
+    void command(ab_bridge_client &client, const char *line)
+    {
+        unsigned int id;
+        unsigned long nad;
+        char arg[16];
+        if (sscanf(line, "sub %u %lu", &id, &nad) == 2 && id <= 255 && client.filterCount < ABBRIDGE_MAX_FILTERS)
+        {
+            client.filters[client.filterCount].sock_id = (uint8_t)id;
+            client.filters[client.filterCount++].nad = (uint32_t)nad;
+        }
+        else if (strncmp(line, "unsub", 5) == 0)
+            client.filterCount = 0;
+        else if (sscanf(line, "format %15s", arg) == 1)
+        {
+            if (strcmp(arg, "json") == 0)
+                client.format = AB_BRIDGE_JSON;
+            else if (strcmp(arg, "binary") == 0)
+                client.format = AB_BRIDGE_BINARY;
+        }
+    }
+    static bool matches(const ab_bridge_client &client, uint8_t sock_id, uint32_t nad)
+    {
+        if (client.filterCount == 0)
+            return true;
+        for (uint8_t i = 0; i < client.filterCount; i++)
+        {
+            const ab_bridge_filter &filter = client.filters[i];
+            if ((filter.sock_id == 0 || filter.sock_id == sock_id) && (filter.nad == 0 || filter.nad == nad))
+                return true;
+        }
+        return false;
+    }
+    // queue the socket for all matching subscribers, each format is encoded once per frame
+    void publish(const ab_socket_view &view, uint16_t ts_id)
+    {
+        uint32_t now = millis();
+        bool binary = false;
+        bool json = false;
+        for (uint8_t i = 0; i < ABBRIDGE_MAX_CLIENTS; i++)
+        {
+            ab_bridge_client &client = m_clients[i];
+            if (client.fd < 0 || !matches(client, view.config.socket_id, view.sender))
+                continue;
+            if (client.format == AB_BRIDGE_JSON)
+            {
+                if (!json)
+                    encodeJson(view, ts_id, now);
+                json = true;
+                enqueue(client, m_json.data(), m_json.size());
+            }
+            else
+            {
+                if (!binary)
+                    encodeBinary(view, ts_id, now);
+                binary = true;
+                enqueue(client, m_binary.data(), m_binary.size());
+            }
+        }
+    }
+    void encodeBinary(const ab_socket_view &view, uint16_t ts_id, uint32_t now)
+    {
+        const ab_socket_config &config = view.config;
+        size_t datalen = ab_getSocketLen(config) - 4;
+        m_binary.resize(ABBRIDGE_RECORD_LEN + datalen);
+        char *p = m_binary.data();
+        ab_storeU16(p, (uint16_t)m_binary.size());
+        p[2] = (char)config.socket_id;
+        p[3] = (char)config.bitcount;
+        p[4] = (char)config.intcount;
+        p[5] = (char)config.longcount;
+        p[6] = (char)config.realcount;
+        p[7] = 0;
+        ab_storeU32(p + 8, view.sender);
+        ab_storeU16(p + 12, ts_id);
+        ab_storeU32(p + 14, now);
+        // the tag sections follow each other in the frame
+        memcpy(p + ABBRIDGE_RECORD_LEN, view.frame + view.bit_pos, datalen);
+    }
+    void encodeJson(const ab_socket_view &view, uint16_t ts_id, uint32_t now)
+    {
+        char buf[80];
+        m_json.clear();
+        snprintf(buf, sizeof(buf), "{\"id\":%u,\"nad\":%lu,\"ts\":%u,\"time\":%lu", view.config.socket_id,
+                 (unsigned long)view.sender, ts_id, (unsigned long)now);
+        m_json += buf;
+        m_json += ",\"bits\":[";
+        for (uint8_t i = 0; i < view.config.bitcount; i++)
+        {
+            if (i > 0)
+                m_json += ',';
+            m_json += view.bit(i) ? '1' : '0';
+        }
+        m_json += "],\"ints\":[";
+        for (uint8_t i = 0; i < view.config.intcount; i++)
+        {
+            snprintf(buf, sizeof(buf), i > 0 ? ",%d" : "%d", view.i16(i));
+            m_json += buf;
+        }
+        m_json += "],\"longs\":[";
+        for (uint8_t i = 0; i < view.config.longcount; i++)
+        {
+            snprintf(buf, sizeof(buf), i > 0 ? ",%ld" : "%ld", (long)view.i32(i));
+            m_json += buf;
+        }
+        m_json += "],\"reals\":[";
+        for (uint8_t i = 0; i < view.config.realcount; i++)
+        {
+            float_t val = view.real(i);
+            // JSON has no NaN or infinity
+            if (isfinite(val))
+                snprintf(buf, sizeof(buf), i > 0 ? ",%.9g" : "%.9g", (double)val);
+            else
+                snprintf(buf, sizeof(buf), i > 0 ? ",null" : "null");
+            m_json += buf;
+        }
+        m_json += "]}\n";
+    }
+    // add a message to the queue of a subscriber, the oldest messages make room for it
+    void enqueue(ab_bridge_client &client, const char *msg, size_t len)
+    {
+        uint32_t size = (uint32_t)client.ring.size();
+        if (len > size)
+        {
+            m_stats.dropped++;
+            return;
+        }
+        while (client.count >= ABBRIDGE_QUEUE_LEN || size - client.ringUsed < len)
+        {
+            popMessage(client, NULL);
+            m_stats.dropped++;
+        }
+        uint32_t tail = (client.ringHead + client.ringUsed) % size;
+        size_t first = min(len, (size_t)(size - tail));
+        memcpy(client.ring.data() + tail, msg, first);
+        memcpy(client.ring.data(), msg + first, len - first);
+        client.ringUsed += (uint32_t)len;
+        client.lens[(client.lenHead + client.count) % ABBRIDGE_QUEUE_LEN] = (uint32_t)len;
+        client.count++;
+        m_stats.queued++;
+    }
+    /**
+     * remove the oldest message from the queue of a subscriber
+     * @param client subscriber
+     * @param out receives the message (NULL = drop it)
+     */
+    static void popMessage(ab_bridge_client &client, std::vector<char> *out)
+    {
+        uint32_t size = (uint32_t)client.ring.size();
+        uint32_t len = client.lens[client.lenHead];
+        if (out != NULL)
+        {
+            uint32_t first = min(len, size - client.ringHead);
+            out->insert(out->end(), client.ring.data() + client.ringHead, client.ring.data() + client.ringHead + first);
+            out->insert(out->end(), client.ring.data(), client.ring.data() + (len - first));
+        }
+        client.ringHead = (client.ringHead + len) % size;
+        client.ringUsed -= len;
+        client.lenHead = (client.lenHead + 1) % ABBRIDGE_QUEUE_LEN;
+        client.count--;
+    }
+    // send the queued messages until the kernel buffer of the subscriber is full
+    void flush(ab_bridge_client &client)
+    {
+        while (client.pending())
+        {
+            if (client.outPos >= client.out.size())
+            {
+                // a message which is being sent is no longer in the queue, so dropping never cuts a message
+                client.out.clear();
+                client.outPos = 0;
+                while (client.count > 0 && client.out.size() < ABBRIDGE_SEND_CHUNK)
+                    popMessage(client, &client.out);
+            }
+            ssize_t sent = send(client.fd, client.out.data() + client.outPos, client.out.size() - client.outPos, MSG_DONTWAIT | MSG_NOSIGNAL);
+            if (sent < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                    disconnect(client);
+                return;
+            }
+            client.outPos += sent;
+            m_stats.bytes += sent;
+        }
+    }
+};
+
+#endif
+#endif
@@ -0,0 +1,403 @@
+/**
+ * abus_capture.h
+ * Purpose: capture of the raw frames which abus_socket receives and sends, with time stamps,
+ * into a RAM buffer or a file (host, ESP32 VFS or LittleFS), and readers for replaying a capture (see abus_replay.h)
+
+ * @author Daniel Gangl
+ */
+#ifndef _ABUS_CAPTURE_H_
+#define _ABUS_CAPTURE_H_
+
+#include <abus_helper.h>
+#include <abus_task.h>
+#include <atomic>
+#include <stdio.h>
+
+/*
+ * capture format (all values little endian), a RAM capture has the same content as a capture file:
+ *   file header:  'A' 'B' 'C' 'P' version(1) 0 0 0
+ *   per frame:    time(4, us) len(2, datagram length) caplen(2, stored bytes) dir(1, ab_capture_dir) 0, caplen bytes of the datagram
+ */
+#define AB_CAPTURE_VERSION 1
+#define AB_CAPTURE_HEADER_LEN 8
+#define AB_CAPTURE_RECORD_LEN 10
+
+// direction of a captured frame
+enum ab_capture_dir : uint8_t
+{
+    AB_CAPTURE_RX = 0, // received datagram (also invalid ones)
+    AB_CAPTURE_TX = 1, // frame handed to the transport
+};
+
+// captured frame without its data
+struct ab_capture_record
+{
+    uint32_t time = 0;   // time stamp in us (micros())
+    uint16_t len = 0;    // length of the datagram
+    uint16_t caplen = 0; // amount of stored bytes (a datagram larger than the receive buffer is truncated)
+    uint8_t dir = 0;     // ab_capture_dir
+};
+
+/**
+ * write the file header of a capture
+ * @param buf buffer with AB_CAPTURE_HEADER_LEN bytes
+ */
+inline void ab_writeCaptureHeader(uint8_t *buf)
+{
+    static const uint8_t header[AB_CAPTURE_HEADER_LEN] = {'A', 'B', 'C', 'P', AB_CAPTURE_VERSION, 0, 0, 0};
+    memcpy(buf, header, sizeof(header));
+}
+
+/**
+ * check the file header of a capture
+ * @param buf buffer with AB_CAPTURE_HEADER_LEN bytes
+ * @return true = known capture format
+ */
+inline bool ab_checkCaptureHeader(const uint8_t *buf)
+{
+    return buf[0] == 'A' && buf[1] == 'B' && buf[2] == 'C' && buf[3] == 'P' && buf[4] == AB_CAPTURE_VERSION;
+}
+
+/**
+ * write the record header of a captured frame
+ * @param buf buffer with AB_CAPTURE_RECORD_LEN bytes
+ * @param rec record
+ */
+inline void ab_writeCaptureRecord(uint8_t *buf, const ab_capture_record &rec)
+{
+    ab_storeU32(buf, rec.time);
+    ab_storeU16(buf + 4, rec.len);
+    ab_storeU16(buf + 6, rec.caplen);
+    buf[8] = rec.dir;
+    buf[9] = 0;
+}
+
+/**
+ * read the record header of a captured frame
+ * @param buf buffer with AB_CAPTURE_RECORD_LEN bytes
+ * @param rec receives the record
+ */
+inline void ab_readCaptureRecord(const uint8_t *buf, ab_capture_record &rec)
+{
+    rec.time = ab_loadU32(buf);
+    rec.len = ab_loadU16(buf + 4);
+    rec.caplen = ab_loadU16(buf + 6);
+    rec.dir = buf[8];
+}
+
+/**
+ * receiver of the captured frames (see abus_socket::setCapture())
+ * write() is called from the receive path and from sendFrame(), i.e. also from the receive and transmit task if they are running,
+ * so it may be called concurrently from loop() and both tasks
+ */
+class ab_capture_sink
+{
+public:
+    virtual ~ab_capture_sink() {}
+    /**
+     * store a captured frame
+     * @param rec record of the frame
+     * @param frame rec.caplen bytes of the datagram
+     */
+    virtual void write(const ab_capture_record &rec, const char *frame) = 0;
+    /**
+     * @return amount of frames which could not be stored
+     */
+    uint32_t dropped() const
+    {
+        return m_dropped;
+    }
+
+protected:
+    std::atomic<uint32_t> m_dropped{0};
+    // count a frame which could not be stored
+    void drop()
+    {
+#ifdef AB_TASK_SUPPORTED
+        // the tasks capture concurrently to the main loop
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+#else
+        // no tasks, only one writer (no atomic read-modify-write on the ESP8266)
+        m_dropped.store(m_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+#endif
+    }
+};
+
+/**
+ * capture into a RAM buffer of the caller, frames which do not fit anymore are dropped
+ * the buffer holds the same bytes as a capture file, so it can be written to a file or replayed with ab_capture_buffer_reader
+ * the content is complete when no frame is captured anymore (setCapture(NULL) and no running receive or transmit task)
+ */
+class ab_capture_ram : public ab_capture_sink
+{
+public:
+    /**
+     * constructor
+     * @param buffer capture buffer, it has to outlive the capture
+     * @param size size of the buffer in bytes
+     */
+    ab_capture_ram(uint8_t *buffer, size_t size) : m_buf(buffer), m_size(size)
+    {
+        clear();
+    }
+    /**
+     * remove all captured frames
+     */
+    void clear()
+    {
+        m_pos.store(0);
+        m_dropped.store(0);
+        if (m_size >= AB_CAPTURE_HEADER_LEN)
+        {
+            ab_writeCaptureHeader(m_buf);
+            m_pos.store(AB_CAPTURE_HEADER_LEN);
+        }
+    }
+    void write(const ab_capture_record &rec, const char *frame) override
+    {
+        size_t need = AB_CAPTURE_RECORD_LEN + rec.caplen;
+        size_t pos = m_pos.load(std::memory_order_relaxed);
+#ifdef AB_TASK_SUPPORTED
+        // the tasks capture concurrently to the main loop, every writer reserves its own range
+        do
+        {
+            if (pos < AB_CAPTURE_HEADER_LEN || pos + need > m_size)
+            {
+                drop();
+                return;
+            }
+        } while (!m_pos.compare_exchange_weak(pos, pos + need, std::memory_order_relaxed));
+#else
+        if (pos < AB_CAPTURE_HEADER_LEN || pos + need > m_size)
+        {
+            drop();
+            return;
+        }
+        m_pos.store(pos + need, std::memory_order_relaxed);
+#endif
+        ab_writeCaptureRecord(m_buf + pos, rec);
+        memcpy(m_buf + pos + AB_CAPTURE_RECORD_LEN, frame, rec.caplen);
+    }
+    /**
+     * @return pointer to the capture
+     */
+    const uint8_t *data() const
+    {
+        return m_buf;
+    }
+    /**
+     * @return length of the capture in bytes
+     */
+    size_t length() const
+    {
+        return m_pos.load();
+    }
+
+private:
+    uint8_t *m_buf;
+    size_t m_size;
+    std::atomic<size_t> m_pos{0}; // end of the used part of the buffer
+};
+
+/**
+ * capture into a stdio file (host, or a file system of the ESP32 VFS, e.g. "/littlefs/capture.abc")
+ * every frame is written with a single fwrite() (larger frames than MAX_DATA_LEN under the stdio lock on the host),
+ * so frames of the receive and transmit task are not mixed into other frames
+ */
+class ab_capture_file : public ab_capture_sink
+{
+public:
+    /**
+     * constructor, writes the file header
+     * @param file file opened for writing in binary mode, it has to outlive the capture and is not closed
+     */
+    ab_capture_file(FILE *file) : m_file(file)
+    {
+        uint8_t header[AB_CAPTURE_HEADER_LEN];
+        ab_writeCaptureHeader(header);
+        if (m_file == NULL || fwrite(header, 1, sizeof(header), m_file) != sizeof(header))
+            m_file = NULL;
+    }
+    void write(const ab_capture_record &rec, const char *frame) override
+    {
+        uint8_t buf[AB_CAPTURE_RECORD_LEN + MAX_DATA_LEN];
+        if (m_file == NULL)
+        {
+            drop();
+            return;
+        }
+#if !defined(ARDUINO)
+        // a large frame of a receive buffer above MAX_DATA_LEN is written behind its record header
+        if (rec.caplen > MAX_DATA_LEN)
+        {
+            ab_writeCaptureRecord(buf, rec);
+            flockfile(m_file);
+            bool ok = fwrite(buf, 1, AB_CAPTURE_RECORD_LEN, m_file) == AB_CAPTURE_RECORD_LEN &&
+                      fwrite(frame, 1, rec.caplen, m_file) == rec.caplen;
+            funlockfile(m_file);
+            if (!ok)
+                drop();
+            return;
+        }
+#endif
+        size_t caplen = min((size_t)rec.caplen, (size_t)MAX_DATA_LEN);
+        ab_capture_record stored = rec;
+        stored.caplen = (uint16_t)caplen;
+        ab_writeCaptureRecord(buf, stored);
+        memcpy(buf + AB_CAPTURE_RECORD_LEN, frame, caplen);
+        if (fwrite(buf, 1, AB_CAPTURE_RECORD_LEN + caplen, m_file) != AB_CAPTURE_RECORD_LEN + caplen)
+            drop();
+    }
+    /**
+     * @return true = file header written
+     */
+    bool valid() const
+    {
+        return m_file != NULL;
+    }
+
+private:
+    FILE *m_file;
+};
+
+/**
+ * capture into an Arduino stream with write(const uint8_t *, size_t), e.g. a LittleFS File
+ * the frames of loop() and the tasks are written one after the other under a mutex (ESP32),
+ * the stream itself must not be used elsewhere while it is capturing
+ * @param F stream class
+ */
+template <class F>
+class ab_capture_stream : public ab_capture_sink
+{
+public:
+    /**
+     * constructor, writes the file header
+     * @param stream stream opened for writing, it has to outlive the capture
+     */
+    ab_capture_stream(F &stream) : m_stream(stream)
+    {
+        uint8_t header[AB_CAPTURE_HEADER_LEN];
+        ab_writeCaptureHeader(header);
+        m_valid = m_stream.write(header, sizeof(header)) == sizeof(header);
+    }
+    void write(const ab_capture_record &rec, const char *frame) override
+    {
+        uint8_t buf[AB_CAPTURE_RECORD_LEN];
+        ab_writeCaptureRecord(buf, rec);
+#ifdef AB_TASK_SUPPORTED
+        // record header and frame are two writes, a frame of another task must not get in between
+        ab_lock lock(m_lock);
+#endif
+        if (!m_valid || m_stream.write(buf, sizeof(buf)) != sizeof(buf) ||
+            m_stream.write(reinterpret_cast<const uint8_t *>(frame), rec.caplen) != rec.caplen)
+            drop();
+    }
+
+private:
+    F &m_stream;
+    bool m_valid;
+#ifdef AB_TASK_SUPPORTED
+    ab_mutex m_lock;
+#endif
+};
+
+/**
+ * source of captured frames for the replay
+ */
+class ab_capture_source
+{
+public:
+    virtual ~ab_capture_source() {}
+    /**
+     * read the next captured frame
+     * @param rec receives the record of the frame (rec.caplen is limited to size)
+     * @param frame receives the stored bytes of the datagram
+     * @param size size of the frame buffer
+     * @return true = frame read, false = end of the capture (or invalid capture)
+     */
+    virtual bool next(ab_capture_record &rec, char *frame, size_t size) = 0;
+};
+
+/**
+ * read a capture from memory (e.g. an ab_capture_ram buffer)
+ */
+class ab_capture_buffer_reader : public ab_capture_source
+{
+public:
+    /**
+     * constructor
+     * @param data capture with file header
+     * @param len length of the capture
+     */
+    ab_capture_buffer_reader(const uint8_t *data, size_t len) : m_data(data), m_len(len)
+    {
+        m_pos = (len >= AB_CAPTURE_HEADER_LEN && ab_checkCaptureHeader(data)) ? AB_CAPTURE_HEADER_LEN : len;
+    }
+    bool next(ab_capture_record &rec, char *frame, size_t size) override
+    {
+        if (m_pos + AB_CAPTURE_RECORD_LEN > m_len)
+            return false;
+        ab_readCaptureRecord(m_data + m_pos, rec);
+        if (m_pos + AB_CAPTURE_RECORD_LEN + rec.caplen > m_len)
+            return false;
+        const uint8_t *stored = m_data + m_pos + AB_CAPTURE_RECORD_LEN;
+        m_pos += AB_CAPTURE_RECORD_LEN + rec.caplen;
+        rec.caplen = (uint16_t)min((size_t)rec.caplen, size);
+        memcpy(frame, stored, rec.caplen);
+        return true;
+    }
+    /**
+     * start again with the first frame
+     */
+    void rewind()
+    {
+        m_pos = min((size_t)AB_CAPTURE_HEADER_LEN, m_len);
+    }
+
+private:
+    const uint8_t *m_data;
+    size_t m_len;
+    size_t m_pos;
+};
+
+/**
+ * read a capture from a stdio file
+ */
+class ab_capture_file_reader : public ab_capture_source
+{
+public:
+    /**
+     * constructor, reads the file header
+     * @param file file opened for reading in binary mode, it is not closed
+     */
+    ab_capture_file_reader(FILE *file) : m_file(file)
+    {
+        uint8_t header[AB_CAPTURE_HEADER_LEN];
+        if (m_file == NULL || fread(header, 1, sizeof(header), m_file) != sizeof(header) || !ab_checkCaptureHeader(header))
+            m_file = NULL;
+    }
+    bool next(ab_capture_record &rec, char *frame, size_t size) override
+    {
+        uint8_t buf[AB_CAPTURE_RECORD_LEN];
+        if (m_file == NULL || fread(buf, 1, sizeof(buf), m_file) != sizeof(buf))
+            return false;
+        ab_readCaptureRecord(buf, rec);
+        size_t copy = min((size_t)rec.caplen, size);
+        if (fread(frame, 1, copy, m_file) != copy || (rec.caplen > copy && fseek(m_file, rec.caplen - copy, SEEK_CUR) != 0))
+            return false;
+        rec.caplen = (uint16_t)copy;
+        return true;
+    }
+    /**
+     * @return true = valid capture file
+     */
+    bool valid() const
+    {
+        return m_file != NULL;
+    }
+
+private:
+    FILE *m_file;
+};
+
+#endif
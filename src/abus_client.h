@@ -0,0 +1,788 @@
+/**
+ * abus_client.h
+ * Purpose: pipelined client for the variable read / write commands of Cybro PLCs on top of abus_socket
+ * the requests are matched to their replies by the ts_id of the frame, several requests can be in flight per PLC
+ * the payload of the commands is encoded by an ab_client_codec of the caller with the command layout of the PLC firmware
+
+ * @author Daniel Gangl
+ */
+#ifndef _ABUS_CLIENT_H_
+#define _ABUS_CLIENT_H_
+
+#include <abus_socket.h>
+#include <abus_value_cache.h>
+
+// amount of requests which can wait or be in flight at the same time (all PLCs)
+#ifndef ABCLI_MAX_REQUESTS
+#define ABCLI_MAX_REQUESTS 16
+#endif
+// amount of requests in flight per PLC, further requests to the same NAD wait until a reply arrives
+#ifndef ABCLI_MAX_INFLIGHT
+#define ABCLI_MAX_INFLIGHT 4
+#endif
+// default reply timeout in ms and amount of repetitions after a timeout
+#ifndef ABCLI_TIMEOUT
+#define ABCLI_TIMEOUT 200
+#endif
+#ifndef ABCLI_RETRIES
+#define ABCLI_RETRIES 2
+#endif
+// amount of cached variable values (power of two, 0 = no cache, see readBatch())
+#ifndef ABCLI_CACHE_LEN
+#define ABCLI_CACHE_LEN 64
+#endif
+// amount of batch reads at the same time and maximum amount of tags per batch read
+#ifndef ABCLI_MAX_BATCHES
+#define ABCLI_MAX_BATCHES 2
+#endif
+#ifndef ABCLI_MAX_BATCH_TAGS
+#define ABCLI_MAX_BATCH_TAGS 64
+#endif
+
+// kind of a request, the codec of the caller translates it into the command frame of the PLC firmware
+// (the library contains no command layout, see ab_client_codec)
+#define ABCLI_CMD_READ 1
+#define ABCLI_CMD_WRITE 2
+
+static_assert(ABCLI_MAX_REQUESTS > 0 && ABCLI_MAX_REQUESTS < 256, "ABCLI_MAX_REQUESTS must be between 1 and 255");
+// the request table of a batch keeps the variable positions in bytes
+static_assert(ABCLI_MAX_BATCH_TAGS > 0 && ABCLI_MAX_BATCH_TAGS < 256, "ABCLI_MAX_BATCH_TAGS must be between 1 and 255");
+
+// data type of a PLC variable
+enum ab_var_type : uint8_t
+{
+    AB_VAR_BIT = 0,  // 1 byte
+    AB_VAR_INT = 1,  // 2 bytes, signed
+    AB_VAR_LONG = 2, // 4 bytes, signed
+    AB_VAR_REAL = 3, // 4 bytes, float
+};
+
+// variable of a read / write request
+struct ab_var
+{
+    uint16_t addr = 0;          // memory address of the variable in the PLC
+    uint8_t type = AB_VAR_INT;  // ab_var_type
+    int32_t value = 0;          // value of a bit, int or long variable
+    float_t real = 0.0;         // value of a real variable
+};
+
+// state of a finished request
+enum ab_request_status : uint8_t
+{
+    AB_REQ_OK = 0,       // reply received, the values of a read request are stored in the variables
+    AB_REQ_TIMEOUT = 1,  // no reply after all repetitions
+    AB_REQ_ERROR = 2,    // the PLC rejected the request (see ab_request_result::plc_status)
+    AB_REQ_INVALID = 3,  // the reply did not match the request
+    AB_REQ_CANCELED = 4, // removed with cancel()
+};
+
+// result of a request which is passed to the completion callback
+struct ab_request_result
+{
+    uint16_t id = 0;                     // id of the request (ts_id of the frames)
+    uint32_t nad = 0;                    // NAD of the PLC
+    uint8_t cmd = 0;                     // ABCLI_CMD_READ or ABCLI_CMD_WRITE
+    ab_request_status status = AB_REQ_OK;
+    uint8_t plc_status = 0;              // status byte of the reply (0 = ok)
+    ab_var *vars = NULL;                 // variables of the request
+    uint8_t count = 0;                   // amount of variables
+};
+
+//Function pointer which is called when a request is finished
+typedef void (*ab_request_callback)(void *ctx, const ab_request_result &result);
+
+// tag of a batch read
+struct ab_batch_tag
+{
+    uint32_t nad = 0;                     // NAD of the PLC
+    ab_var var;                           // address and type of the variable, receives the value
+    uint16_t ttl = 0;                     // a cached value which is not older than ttl ms is used instead of a read (0 = always read)
+    ab_request_status status = AB_REQ_OK; // result of the tag
+    bool cached = false;                  // true = value taken from the cache
+};
+
+//Function pointer which is called when all tags of a batch read are finished
+typedef void (*ab_batch_callback)(void *ctx, ab_batch_tag *tags, uint16_t count);
+
+// counters of the client
+struct ab_client_stats
+{
+    uint32_t requests = 0; // accepted requests
+    uint32_t sent = 0;     // request frames queued (including repetitions)
+    uint32_t replies = 0;  // matching replies
+    uint32_t retries = 0;  // repetitions after a timeout
+    uint32_t timeouts = 0; // requests without a reply
+    uint32_t unknown = 0;  // replies without a waiting request (e.g. late replies of repeated requests)
+    uint32_t batches = 0;  // accepted batch reads
+    uint32_t cached = 0;   // batch tags answered from the cache
+};
+
+/**
+ * @param type ab_var_type
+ * @return size of the variable in a frame
+ */
+inline uint8_t ab_varSize(uint8_t type)
+{
+    return type == AB_VAR_BIT ? 1 : type == AB_VAR_INT ? 2 : 4;
+}
+
+/**
+ * @param var variable
+ * @return value bits of the variable (real as float bits)
+ */
+inline uint32_t ab_getVarRaw(const ab_var &var)
+{
+    uint32_t retval = (uint32_t)var.value;
+    if (var.type == AB_VAR_REAL)
+        memcpy(&retval, &var.real, 4);
+    return retval;
+}
+
+/**
+ * set the value of a variable from the bits of a frame
+ * @param var variable
+ * @param raw value bits (little endian bytes of the frame)
+ */
+inline void ab_setVarRaw(ab_var &var, uint32_t raw)
+{
+    if (var.type == AB_VAR_BIT)
+        var.value = raw != 0;
+    else if (var.type == AB_VAR_INT)
+        var.value = (int16_t)raw;
+    else if (var.type == AB_VAR_LONG)
+        var.value = (int32_t)raw;
+    else
+        memcpy(&var.real, &raw, 4);
+}
+
+/**
+ * payload codec of the variable commands, the client only adds header, ts_id and checksum and matches the replies by ts_id
+ * the library does not implement the variable service of a PLC firmware: the caller derives a codec with the command
+ * layout of its firmware and passes it to the abus_client constructor
+ */
+class ab_client_codec
+{
+public:
+    virtual ~ab_client_codec() {}
+    /**
+     * set dir and typ of the header of a request frame
+     * @param header header of the request
+     */
+    virtual void requestHeader(ab_header &header) const = 0;
+    /**
+     * @param header header of a received frame which is no socket
+     * @return true = the frame may be a reply of a request (it is matched by ts_id and sender afterwards)
+     */
+    virtual bool isReply(const ab_header &header) const = 0;
+    /**
+     * @param cmd ABCLI_CMD_READ or ABCLI_CMD_WRITE
+     * @param vars variables of the request
+     * @param count amount of variables
+     * @return payload length of the request frame (0 = request not supported)
+     */
+    virtual size_t requestLen(uint8_t cmd, const ab_var *vars, uint8_t count) const = 0;
+    /**
+     * @param cmd ABCLI_CMD_READ or ABCLI_CMD_WRITE
+     * @param vars variables of the request
+     * @param count amount of variables
+     * @return payload length of the reply frame
+     */
+    virtual size_t replyLen(uint8_t cmd, const ab_var *vars, uint8_t count) const = 0;
+    /**
+     * encode the payload of a request
+     * @param payload receives requestLen() bytes
+     * @param cmd ABCLI_CMD_READ or ABCLI_CMD_WRITE
+     * @param vars variables of the request
+     * @param count amount of variables
+     */
+    virtual void encodeRequest(char *payload, uint8_t cmd, const ab_var *vars, uint8_t count) const = 0;
+    /**
+     * decode the payload of a reply, the values of a read request are stored in the variables
+     * @param payload payload of the reply
+     * @param len length of the payload
+     * @param cmd ABCLI_CMD_READ or ABCLI_CMD_WRITE of the request
+     * @param vars variables of the request
+     * @param count amount of variables
+     * @param plc_status receives the status of the PLC
+     * @return AB_REQ_OK, AB_REQ_ERROR (PLC status not 0) or AB_REQ_INVALID
+     */
+    virtual ab_request_status decodeReply(const char *payload, size_t len, uint8_t cmd, ab_var *vars, uint8_t count, uint8_t &plc_status) const = 0;
+};
+
+/**
+ * client for variable read and write requests
+ * usage:
+ *   abus_client client(abSock, plcCodec);
+ *   client.read(plcNad, vars, 3, onRead);
+ *   loop() { abSock.loop(); client.loop(); }
+ */
+class abus_client
+{
+public:
+    /**
+     * constructor, the client registers itself with addFrameHook(), a hook of setFrameHook() keeps working
+     * @param sock abus socket which sends and receives the frames (must outlive this object)
+     * @param codec command layout of the PLC firmware (must outlive this object)
+     */
+    abus_client(abus_socket &sock, const ab_client_codec &codec);
+    ~abus_client();
+    /**
+     * set the reply timeout
+     * @param timeoutMs time in ms after which a request is sent again
+     * @param retries amount of repetitions before the request fails with AB_REQ_TIMEOUT
+     */
+    void setTimeout(uint16_t timeoutMs, uint8_t retries = ABCLI_RETRIES);
+    /**
+     * read variables of a PLC
+     * @param nad NAD of the PLC
+     * @param vars variables with address and type, the values are stored in them; the table has to outlive the request
+     * @param count amount of variables (see readFits())
+     * @param cb completion callback (NULL = no notification)
+     * @param ctx context which is passed to the callback
+     * @return id of the request (0 = error: no free entry, invalid NAD or too many variables)
+     */
+    uint16_t read(uint32_t nad, ab_var *vars, uint8_t count, ab_request_callback cb = NULL, void *ctx = NULL);
+    /**
+     * write variables of a PLC
+     * @param nad NAD of the PLC
+     * @param vars variables with address, type and value; the table has to outlive the request
+     * @param count amount of variables (see writeFits())
+     * @param cb completion callback (NULL = no notification)
+     * @param ctx context which is passed to the callback
+     * @return id of the request (0 = error)
+     */
+    uint16_t write(uint32_t nad, ab_var *vars, uint8_t count, ab_request_callback cb = NULL, void *ctx = NULL);
+    /**
+     * read tags of one or more PLCs with as few frames as possible
+     * tags with a cached value younger than their ttl are answered from the cache, the others are grouped per NAD
+     * and packed into as few read requests as fit into a request and a reply frame of the codec (requestLen(), replyLen());
+     * the callback is called when all tags are finished
+     * @param tags tags with NAD, address, type and ttl, they receive value and status; the table has to outlive the batch
+     * @param count amount of tags (ABCLI_MAX_BATCH_TAGS)
+     * @param cb completion callback (called at once if all tags are cached)
+     * @param ctx context which is passed to the callback
+     * @return true = batch started, false = too many tags, a tag which the codec can not read, no free batch or not enough free request entries
+     */
+    bool readBatch(ab_batch_tag *tags, uint16_t count, ab_batch_callback cb, void *ctx = NULL);
+    /**
+     * get a cached value of a variable (filled by successful reads and writes)
+     * @param nad NAD of the PLC
+     * @param var variable with address and type, receives the value
+     * @param maxAgeMs maximum age of the value in ms
+     * @return true = valid value found
+     */
+    bool getCached(uint32_t nad, ab_var &var, uint16_t maxAgeMs);
+    /**
+     * remove cached values
+     * @param nad NAD of the PLC (0 = all values)
+     */
+    void invalidate(uint32_t nad = 0);
+    /**
+     * remove a request, its callback is called with AB_REQ_CANCELED
+     * @param id id of the request
+     * @return true = request found
+     */
+    bool cancel(uint16_t id);
+    /**
+     * send waiting requests and repeat / finish requests without reply, has to be called cyclic after abus_socket::loop()
+     */
+    void loop();
+    /**
+     * @return amount of waiting and running requests
+     */
+    uint8_t pending() const;
+    /**
+     * @return counters of the client
+     */
+    ab_client_stats getStats() const;
+    /**
+     * check if a read request fits into one request and one reply frame of the codec
+     * @param vars variables
+     * @param count amount of variables
+     * @return true = fits
+     */
+    bool readFits(const ab_var *vars, uint8_t count) const;
+    /**
+     * check if a write request fits into one request and one reply frame of the codec
+     * @param vars variables
+     * @param count amount of variables
+     * @return true = fits
+     */
+    bool writeFits(const ab_var *vars, uint8_t count) const;
+
+private:
+    // request in the request table
+    struct ab_request
+    {
+        uint16_t id = 0;             // ts_id of the request frames (0 = free entry)
+        uint8_t cmd = 0;             // ABCLI_CMD_READ or ABCLI_CMD_WRITE
+        bool sent = false;           // false = waiting for a free in flight place of the NAD
+        uint8_t tries = 0;           // amount of sent frames
+        uint32_t nad = 0;            // NAD of the PLC
+        uint32_t seq = 0;            // order of the requests
+        uint32_t time = 0;           // time of the last sent frame in ms
+        ab_var *vars = NULL;         // variables, owned by the caller
+        uint8_t count = 0;           // amount of variables
+        ab_request_callback cb = NULL;
+        void *ctx = NULL;
+    };
+    // running batch read
+    struct ab_batch
+    {
+        abus_client *client = NULL;
+        ab_batch_tag *tags = NULL;                // tags of the caller (NULL = free entry)
+        uint16_t count = 0;                       // amount of tags
+        uint8_t open = 0;                         // amount of unfinished read requests
+        ab_batch_callback cb = NULL;
+        void *ctx = NULL;
+        ab_var vars[ABCLI_MAX_BATCH_TAGS];        // variables of the read requests, grouped per NAD
+        uint16_t tag[ABCLI_MAX_BATCH_TAGS];       // tag index of each variable
+    };
+    abus_socket &m_sock;
+    const ab_client_codec *m_codec;  // payload layout of the commands
+    ab_request m_requests[ABCLI_MAX_REQUESTS];
+    // the messages use the log level of the socket
+    ab_log_level logLevel() const
+    {
+        return m_sock.logLevel();
+    }
+#if ABCLI_MAX_BATCHES > 0
+    ab_batch m_batches[ABCLI_MAX_BATCHES];
+#endif
+#if ABCLI_CACHE_LEN > 0
+    ab_value_cache<ABCLI_CACHE_LEN> m_cache;   // values of successful reads and writes
+#endif
+    uint16_t m_nextId = 0;           // last used ts_id
+    uint32_t m_seq = 0;              // order counter of the requests
+    uint16_t m_timeout = ABCLI_TIMEOUT;
+    uint8_t m_retries = ABCLI_RETRIES;
+    ab_client_stats m_stats;
+    /**
+     * add a request to the request table and send it if the NAD has a free in flight place
+     * @return id of the request (0 = no free entry)
+     */
+    uint16_t addRequest(uint8_t cmd, uint32_t nad, ab_var *vars, uint8_t count, ab_request_callback cb, void *ctx);
+    /**
+     * encode and queue the frame of a request
+     * @return true = frame queued
+     */
+    bool sendRequest(ab_request &req);
+    /**
+     * send waiting requests in request order while their NAD has a free in flight place
+     */
+    void sendWaiting();
+    /**
+     * @return amount of requests in flight to a NAD
+     */
+    uint8_t inflight(uint32_t nad) const;
+    /**
+     * remove a request from the table and call its callback
+     */
+    void finish(ab_request &req, ab_request_status status, uint8_t plc_status = 0);
+    /**
+     * match a reply to its request
+     */
+    void handleReply(const char *frame, size_t len, const ab_header &header);
+    /**
+     * @return true = a request with the command and variables fits into one request and one reply frame
+     */
+    bool fits(uint8_t cmd, const ab_var *vars, uint8_t count) const;
+    /**
+     * finish the tags of a read request of a batch and the batch after its last request
+     */
+    static void batchRequestDone(void *ctx, const ab_request_result &result);
+    static void frameHook(void *ctx, const char *frame, size_t len, const ab_header &header);
+};
+
+// code implementations
+
+abus_client::abus_client(abus_socket &sock, const ab_client_codec &codec) : m_sock(sock), m_codec(&codec)
+{
+    if (!m_sock.addFrameHook(frameHook, this))
+        ABSOCK_ERR_PRINTLN(F("*AB: abus_client()->no free frame hook (ABSOCK_MAX_FRAME_HOOKS)!"));
+}
+abus_client::~abus_client()
+{
+    m_sock.removeFrameHook(frameHook, this);
+}
+void abus_client::setTimeout(uint16_t timeoutMs, uint8_t retries)
+{
+    m_timeout = timeoutMs;
+    m_retries = retries;
+}
+bool abus_client::fits(uint8_t cmd, const ab_var *vars, uint8_t count) const
+{
+    if (count == 0)
+        return false;
+    size_t requestLen = m_codec->requestLen(cmd, vars, count);
+    return requestLen > 0 && requestLen <= AB_MAX_SOCKET_DATA && m_codec->replyLen(cmd, vars, count) <= AB_MAX_SOCKET_DATA;
+}
+bool abus_client::readFits(const ab_var *vars, uint8_t count) const
+{
+    return fits(ABCLI_CMD_READ, vars, count);
+}
+bool abus_client::writeFits(const ab_var *vars, uint8_t count) const
+{
+    return fits(ABCLI_CMD_WRITE, vars, count);
+}
+uint16_t abus_client::read(uint32_t nad, ab_var *vars, uint8_t count, ab_request_callback cb, void *ctx)
+{
+    if (nad == 0 || vars == NULL || !readFits(vars, count))
+    {
+        ABSOCK_ERR_PRINTLN(F("*AB: read()->invalid request!"));
+        return 0;
+    }
+    return addRequest(ABCLI_CMD_READ, nad, vars, count, cb, ctx);
+}
+uint16_t abus_client::write(uint32_t nad, ab_var *vars, uint8_t count, ab_request_callback cb, void *ctx)
+{
+    if (nad == 0 || vars == NULL || !writeFits(vars, count))
+    {
+        ABSOCK_ERR_PRINTLN(F("*AB: write()->invalid request!"));
+        return 0;
+    }
+    return addRequest(ABCLI_CMD_WRITE, nad, vars, count, cb, ctx);
+}
+uint16_t abus_client::addRequest(uint8_t cmd, uint32_t nad, ab_var *vars, uint8_t count, ab_request_callback cb, void *ctx)
+{
+    ab_request *req = NULL;
+    for (uint8_t i = 0; i < ABCLI_MAX_REQUESTS && req == NULL; i++)
+    {
+        if (m_requests[i].id == 0)
+            req = &m_requests[i];
+    }
+    if (req == NULL)
+    {
+        ABSOCK_ERR_PRINTLN(F("*AB: request()->no free request entry!"));
+        return 0;
+    }
+    // ts_id 0 marks a free entry and is skipped, an id is only reused after 65535 requests
+    do
+    {
+        m_nextId++;
+    } while (m_nextId == 0);
+    req->id = m_nextId;
+    req->cmd = cmd;
+    req->sent = false;
+    req->tries = 0;
+    req->nad = nad;
+    req->seq = m_seq++;
+    req->vars = vars;
+    req->count = count;
+    req->cb = cb;
+    req->ctx = ctx;
+    m_stats.requests++;
+    uint16_t retval = req->id;
+    sendWaiting();
+    return retval;
+}
+bool abus_client::sendRequest(ab_request &req)
+{
+    char frame[MAX_DATA_LEN];
+    size_t datalen = m_codec->requestLen(req.cmd, req.vars, req.count);
+    ab_header header;
+    header.len = (uint16_t)(datalen + 4);
+    header.from = m_sock.getOwnNad();
+    header.to = req.nad;
+    m_codec->requestHeader(header);
+    ab_frame_writer writer(frame, sizeof(frame));
+    ab_writeHeader(writer, header);
+    char *p = writer.section(datalen);
+    if (p == NULL)
+        return false;
+    m_codec->encodeRequest(p, req.cmd, req.vars, req.count);
+    writer.putUInt(req.id);
+    size_t len = writer.finish();
+    ab_send_result result = len > 0 ? m_sock.queueRaw(frame, len) : AB_SEND_INVALID;
+    if (result != AB_SEND_QUEUED && result != AB_SEND_OK)
+        return false;
+    req.sent = true;
+    req.tries++;
+    req.time = millis();
+    m_stats.sent++;
+    return true;
+}
+uint8_t abus_client::inflight(uint32_t nad) const
+{
+    uint8_t retval = 0;
+    for (uint8_t i = 0; i < ABCLI_MAX_REQUESTS; i++)
+    {
+        if (m_requests[i].id != 0 && m_requests[i].sent && m_requests[i].nad == nad)
+            retval++;
+    }
+    return retval;
+}
+void abus_client::sendWaiting()
+{
+    while (true)
+    {
+        // the oldest waiting request of a NAD with a free in flight place goes first
+        ab_request *next = NULL;
+        for (uint8_t i = 0; i < ABCLI_MAX_REQUESTS; i++)
+        {
+            ab_request &req = m_requests[i];
+            if (req.id == 0 || req.sent || (next != NULL && (int32_t)(req.seq - next->seq) >= 0))
+                continue;
+            if (inflight(req.nad) < ABCLI_MAX_INFLIGHT)
+                next = &req;
+        }
+        // a full transmit queue is tried again in the next loop()
+        if (next == NULL || !sendRequest(*next))
+            return;
+    }
+}
+void abus_client::finish(ab_request &req, ab_request_status status, uint8_t plc_status)
+{
+    ab_request_result result;
+    result.id = req.id;
+    result.nad = req.nad;
+    result.cmd = req.cmd;
+    result.status = status;
+    result.plc_status = plc_status;
+    result.vars = req.vars;
+    result.count = req.count;
+#if ABCLI_CACHE_LEN > 0
+    // the cache holds the last known value of every read or written variable
+    if (status == AB_REQ_OK)
+    {
+        uint32_t now = millis();
+        for (uint8_t i = 0; i < req.count; i++)
+            m_cache.store(req.nad, req.vars[i].addr, req.vars[i].type, ab_getVarRaw(req.vars[i]), now);
+    }
+#endif
+    ab_request_callback cb = req.cb;
+    void *ctx = req.ctx;
+    // the entry is free before the callback, it may start the next request
+    req = ab_request();
+    if (cb != NULL)
+        cb(ctx, result);
+}
+bool abus_client::cancel(uint16_t id)
+{
+    for (uint8_t i = 0; i < ABCLI_MAX_REQUESTS; i++)
+    {
+        if (id != 0 && m_requests[i].id == id)
+        {
+            finish(m_requests[i], AB_REQ_CANCELED);
+            return true;
+        }
+    }
+    return false;
+}
+void abus_client::loop()
+{
+    uint32_t now = millis();
+    for (uint8_t i = 0; i < ABCLI_MAX_REQUESTS; i++)
+    {
+        ab_request &req = m_requests[i];
+        if (req.id == 0 || !req.sent || (uint32_t)(now - req.time) < m_timeout)
+            continue;
+        if (req.tries > m_retries)
+        {
+            ABSOCK_ERR_PRINTF("*AB: request()->timeout, nad=%lu, id=%u\n", (unsigned long)req.nad, req.id);
+            m_stats.timeouts++;
+            finish(req, AB_REQ_TIMEOUT);
+        }
+        // the repetition keeps the ts_id, a late reply of the first frame finishes the request as well
+        else if (sendRequest(req))
+            m_stats.retries++;
+    }
+    sendWaiting();
+}
+bool abus_client::getCached(uint32_t nad, ab_var &var, uint16_t maxAgeMs)
+{
+#if ABCLI_CACHE_LEN > 0
+    uint32_t raw;
+    if (m_cache.lookup(nad, var.addr, var.type, maxAgeMs, millis(), raw))
+    {
+        ab_setVarRaw(var, raw);
+        return true;
+    }
+#else
+    (void)nad;
+    (void)var;
+    (void)maxAgeMs;
+#endif
+    return false;
+}
+void abus_client::invalidate(uint32_t nad)
+{
+#if ABCLI_CACHE_LEN > 0
+    m_cache.invalidate(nad);
+#else
+    (void)nad;
+#endif
+}
+bool abus_client::readBatch(ab_batch_tag *tags, uint16_t count, ab_batch_callback cb, void *ctx)
+{
+#if ABCLI_MAX_BATCHES > 0
+    if (tags == NULL || count == 0 || count > ABCLI_MAX_BATCH_TAGS)
+    {
+        ABSOCK_ERR_PRINTLN(F("*AB: readBatch()->invalid batch!"));
+        return false;
+    }
+    ab_batch *batch = NULL;
+    for (uint8_t i = 0; i < ABCLI_MAX_BATCHES && batch == NULL; i++)
+    {
+        if (m_batches[i].tags == NULL)
+            batch = &m_batches[i];
+    }
+    if (batch == NULL)
+    {
+        ABSOCK_ERR_PRINTLN(F("*AB: readBatch()->no free batch entry!"));
+        return false;
+    }
+    // tags with a fresh cached value are finished at once, the others are grouped per NAD in request order
+    uint16_t varCount = 0;
+    uint16_t cached = 0;
+    for (uint16_t i = 0; i < count; i++)
+    {
+        tags[i].status = AB_REQ_OK;
+        tags[i].cached = tags[i].ttl > 0 && getCached(tags[i].nad, tags[i].var, tags[i].ttl);
+        if (tags[i].cached)
+        {
+            cached++;
+            continue;
+        }
+        if (tags[i].nad == 0)
+        {
+            tags[i].status = AB_REQ_INVALID;
+            continue;
+        }
+        // the tag is inserted behind the last variable of the same NAD, later groups move one place up
+        uint16_t pos = varCount;
+        for (uint16_t j = varCount; j > 0; j--)
+        {
+            if (tags[batch->tag[j - 1]].nad == tags[i].nad)
+            {
+                pos = j;
+                break;
+            }
+        }
+        for (uint16_t j = varCount; j > pos; j--)
+            batch->tag[j] = batch->tag[j - 1];
+        batch->tag[pos] = i;
+        varCount++;
+    }
+    // split every NAD group into requests which fit into one request and one reply frame of the codec
+    for (uint16_t i = 0; i < varCount; i++)
+        batch->vars[i] = tags[batch->tag[i]].var;
+    uint8_t starts[ABCLI_MAX_BATCH_TAGS];
+    uint8_t lens[ABCLI_MAX_BATCH_TAGS];
+    uint8_t requests = 0;
+    uint16_t start = 0;
+    while (start < varCount)
+    {
+        uint32_t nad = tags[batch->tag[start]].nad;
+        uint16_t end = start;
+        while (end < varCount && tags[batch->tag[end]].nad == nad && end - start < 255 &&
+               fits(ABCLI_CMD_READ, &batch->vars[start], (uint8_t)(end - start + 1)))
+            end++;
+        if (end == start)
+        {
+            ABSOCK_ERR_PRINTLN(F("*AB: readBatch()->tag does not fit into a frame!"));
+            return false;
+        }
+        starts[requests] = (uint8_t)start;
+        lens[requests] = (uint8_t)(end - start);
+        requests++;
+        start = end;
+    }
+    // the batch is only started if all of its requests fit into the request table
+    uint8_t freeEntries = 0;
+    for (uint8_t i = 0; i < ABCLI_MAX_REQUESTS; i++)
+        freeEntries += m_requests[i].id == 0;
+    if (requests > freeEntries)
+    {
+        ABSOCK_ERR_PRINTLN(F("*AB: readBatch()->not enough free request entries!"));
+        return false;
+    }
+    m_stats.batches++;
+    m_stats.cached += cached;
+    batch->client = this;
+    batch->tags = tags;
+    batch->count = count;
+    batch->open = requests;
+    batch->cb = cb;
+    batch->ctx = ctx;
+    if (requests == 0)
+    {
+        batch->tags = NULL;
+        if (cb != NULL)
+            cb(ctx, tags, count);
+        return true;
+    }
+    for (uint8_t i = 0; i < requests; i++)
+        addRequest(ABCLI_CMD_READ, tags[batch->tag[starts[i]]].nad, &batch->vars[starts[i]], lens[i], batchRequestDone, batch);
+    return true;
+#else
+    (void)tags;
+    (void)count;
+    (void)cb;
+    (void)ctx;
+    return false;
+#endif
+}
+void abus_client::batchRequestDone(void *ctx, const ab_request_result &result)
+{
+#if ABCLI_MAX_BATCHES > 0
+    ab_batch *batch = static_cast<ab_batch *>(ctx);
+    uint16_t first = (uint16_t)(result.vars - batch->vars);
+    for (uint8_t i = 0; i < result.count; i++)
+    {
+        ab_batch_tag &tag = batch->tags[batch->tag[first + i]];
+        tag.status = result.status;
+        if (result.status == AB_REQ_OK)
+            tag.var = result.vars[i];
+    }
+    if (--batch->open > 0)
+        return;
+    ab_batch_tag *tags = batch->tags;
+    ab_batch_callback cb = batch->cb;
+    void *cbCtx = batch->ctx;
+    // the entry is free before the callback, it may start the next batch
+    batch->tags = NULL;
+    if (cb != NULL)
+        cb(cbCtx, tags, batch->count);
+#else
+    (void)ctx;
+    (void)result;
+#endif
+}
+uint8_t abus_client::pending() const
+{
+    uint8_t retval = 0;
+    for (uint8_t i = 0; i < ABCLI_MAX_REQUESTS; i++)
+        retval += m_requests[i].id != 0;
+    return retval;
+}
+ab_client_stats abus_client::getStats() const
+{
+    return m_stats;
+}
+void abus_client::frameHook(void *ctx, const char *frame, size_t len, const ab_header &header)
+{
+    static_cast<abus_client *>(ctx)->handleReply(frame, len, header);
+}
+void abus_client::handleReply(const char *frame, size_t len, const ab_header &header)
+{
+    if (!m_codec->isReply(header) || header.len < 4 || header.len + 14u > len)
+        return;
+    ab_request *req = NULL;
+    for (uint8_t i = 0; i < ABCLI_MAX_REQUESTS && req == NULL; i++)
+    {
+        if (m_requests[i].id == header.ts_id && m_requests[i].sent && m_requests[i].nad == header.from)
+            req = &m_requests[i];
+    }
+    if (header.ts_id == 0 || req == NULL)
+    {
+        m_stats.unknown++;
+        return;
+    }
+    m_stats.replies++;
+    uint8_t plc_status = 0;
+    ab_request_status status = m_codec->decodeReply(frame + 14, header.len - 4, req->cmd, req->vars, req->count, plc_status);
+    finish(*req, status, plc_status);
+}
+
+#endif
@@ -0,0 +1,272 @@
+/**
+ * abus_codec.h
+ * Purpose: little endian loads and stores of the tag values of an abus frame, single values and whole tag sections
+ * all functions work on the bytes of the caller only (no shared scratch memory), so they can be used
+ * from several tasks at the same time, and they do not depend on the signedness of char
+
+ * @author Daniel Gangl
+ */
+#ifndef _ABUS_CODEC_H_
+#define _ABUS_CODEC_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+// the abus frame is little endian, on little endian targets whole tag sections can be copied
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define AB_LITTLE_ENDIAN 1
+#else
+#define AB_LITTLE_ENDIAN 0
+#endif
+
+static_assert(sizeof(float_t) == 4, "abus real tags are 4 byte floats");
+
+/**
+ * @param val value
+ * @return value with swapped byte order
+ */
+constexpr uint16_t ab_bswap16(uint16_t val)
+{
+    return (uint16_t)(val << 8 | val >> 8);
+}
+
+/**
+ * @param val value
+ * @return value with swapped byte order
+ */
+constexpr uint32_t ab_bswap32(uint32_t val)
+{
+    return val << 24 | (val & 0xFF00u) << 8 | (val >> 8 & 0xFF00u) | val >> 24;
+}
+
+/**
+ * compose a little endian 16 bit value (also usable in constant expressions)
+ * @param b0 first byte of the frame
+ * @param b1 second byte of the frame
+ * @return value
+ */
+constexpr uint16_t ab_le16(uint8_t b0, uint8_t b1)
+{
+    return (uint16_t)(b0 | b1 << 8);
+}
+
+/**
+ * compose a little endian 32 bit value (also usable in constant expressions)
+ * @param b0 first byte of the frame
+ * @param b1 second byte of the frame
+ * @param b2 third byte of the frame
+ * @param b3 fourth byte of the frame
+ * @return value
+ */
+constexpr uint32_t ab_le32(uint8_t b0, uint8_t b1, uint8_t b2, uint8_t b3)
+{
+    return (uint32_t)b0 | (uint32_t)b1 << 8 | (uint32_t)b2 << 16 | (uint32_t)b3 << 24;
+}
+
+/**
+ * load a little endian unsigned integer (2 bytes) from any address
+ * @param p pointer into the frame
+ * @return value
+ */
+inline uint16_t ab_loadU16(const void *p)
+{
+    uint16_t retval;
+    memcpy(&retval, p, sizeof(retval));
+#if !AB_LITTLE_ENDIAN
+    retval = ab_bswap16(retval);
+#endif
+    return retval;
+}
+
+/**
+ * load a little endian unsigned long (4 bytes) from any address
+ * @param p pointer into the frame
+ * @return value
+ */
+inline uint32_t ab_loadU32(const void *p)
+{
+    uint32_t retval;
+    memcpy(&retval, p, sizeof(retval));
+#if !AB_LITTLE_ENDIAN
+    retval = ab_bswap32(retval);
+#endif
+    return retval;
+}
+
+/**
+ * load a little endian integer (2 bytes) from any address
+ * @param p pointer into the frame
+ * @return value
+ */
+inline int16_t ab_loadI16(const void *p)
+{
+    return (int16_t)ab_loadU16(p);
+}
+
+/**
+ * load a little endian long (4 bytes) from any address
+ * @param p pointer into the frame
+ * @return value
+ */
+inline int32_t ab_loadI32(const void *p)
+{
+    return (int32_t)ab_loadU32(p);
+}
+
+/**
+ * load a little endian real (IEEE 754 single) from any address
+ * @param p pointer into the frame
+ * @return value
+ */
+inline float_t ab_loadReal(const void *p)
+{
+    uint32_t bits = ab_loadU32(p);
+    float_t retval;
+    memcpy(&retval, &bits, sizeof(retval));
+    return retval;
+}
+
+/**
+ * store a little endian unsigned integer (2 bytes) at any address
+ * @param p pointer into the frame
+ * @param val value
+ */
+inline void ab_storeU16(void *p, uint16_t val)
+{
+#if !AB_LITTLE_ENDIAN
+    val = ab_bswap16(val);
+#endif
+    memcpy(p, &val, sizeof(val));
+}
+
+/**
+ * store a little endian unsigned long (4 bytes) at any address
+ * @param p pointer into the frame
+ * @param val value
+ */
+inline void ab_storeU32(void *p, uint32_t val)
+{
+#if !AB_LITTLE_ENDIAN
+    val = ab_bswap32(val);
+#endif
+    memcpy(p, &val, sizeof(val));
+}
+
+/**
+ * store a little endian real (IEEE 754 single) at any address
+ * @param p pointer into the frame
+ * @param val value
+ */
+inline void ab_storeReal(void *p, float_t val)
+{
+    uint32_t bits;
+    memcpy(&bits, &val, sizeof(bits));
+    ab_storeU32(p, bits);
+}
+
+/*
+ * bulk decoders and encoders of whole tag sections
+ * the loops have no branches per tag and the compiler vectorizes them (a plain copy on little endian targets,
+ * byte swaps on other targets), for the short sections of a frame this is faster than a memcpy() call
+ */
+
+/**
+ * decode the bit section of a frame, every byte which is not 0 is a set bit
+ * @param src first bit tag in the frame
+ * @param dst receives count values 0 / 1
+ * @param count amount of bit tags
+ */
+inline void ab_decodeBits(const char *src, uint8_t *dst, size_t count)
+{
+    const uint8_t *s = reinterpret_cast<const uint8_t *>(src);
+    for (size_t i = 0; i < count; i++)
+        dst[i] = s[i] != 0;
+}
+
+/**
+ * decode the int section of a frame
+ * @param src first int tag in the frame
+ * @param dst receives count values
+ * @param count amount of int tags
+ */
+inline void ab_decodeInts(const char *src, int16_t *dst, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        dst[i] = ab_loadI16(src + i * 2);
+}
+
+/**
+ * decode the long section of a frame
+ * @param src first long tag in the frame
+ * @param dst receives count values
+ * @param count amount of long tags
+ */
+inline void ab_decodeLongs(const char *src, int32_t *dst, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        dst[i] = ab_loadI32(src + i * 4);
+}
+
+/**
+ * decode the real section of a frame
+ * @param src first real tag in the frame
+ * @param dst receives count values
+ * @param count amount of real tags
+ */
+inline void ab_decodeReals(const char *src, float_t *dst, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        dst[i] = ab_loadReal(src + i * 4);
+}
+
+/**
+ * encode the bit section of a frame, every value which is not 0 is written as 1
+ * @param src count bit values
+ * @param dst first bit tag in the frame
+ * @param count amount of bit tags
+ */
+inline void ab_encodeBits(const uint8_t *src, char *dst, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        dst[i] = (char)(src[i] != 0);
+}
+
+/**
+ * encode the int section of a frame
+ * @param src count values
+ * @param dst first int tag in the frame
+ * @param count amount of int tags
+ */
+inline void ab_encodeInts(const int16_t *src, char *dst, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        ab_storeU16(dst + i * 2, (uint16_t)src[i]);
+}
+
+/**
+ * encode the long section of a frame
+ * @param src count values
+ * @param dst first long tag in the frame
+ * @param count amount of long tags
+ */
+inline void ab_encodeLongs(const int32_t *src, char *dst, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        ab_storeU32(dst + i * 4, (uint32_t)src[i]);
+}
+
+/**
+ * encode the real section of a frame
+ * @param src count values
+ * @param dst first real tag in the frame
+ * @param count amount of real tags
+ */
+inline void ab_encodeReals(const float_t *src, char *dst, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        ab_storeReal(dst + i * 4, src[i]);
+}
+
+#endif
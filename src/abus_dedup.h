@@ -0,0 +1,154 @@
+/**
+ * abus_dedup.h
+ * Purpose: suppression of duplicated and late socket frames by the ts_id per sender NAD and socket id,
+ * e.g. retransmissions of a PLC or broadcasts repeated by several access points
+
+ * @author Daniel Gangl
+ */
+#ifndef _ABUS_DEDUP_H_
+#define _ABUS_DEDUP_H_
+
+#include <abus_helper.h>
+
+// amount of table entries which are probed for a sender (the cost per frame does not grow with the table size)
+#ifndef AB_DEDUP_PROBES
+#define AB_DEDUP_PROBES 8
+#endif
+// a ts_id up to this distance behind the last one is a late frame, a larger step back is a restart of the sender
+#ifndef AB_DEDUP_WINDOW
+#define AB_DEDUP_WINDOW 256
+#endif
+
+// result of the check of a received frame
+enum ab_dedup_result : uint8_t
+{
+    AB_DEDUP_NEW = 0,       // new frame (or no ts_id, unknown sender)
+    AB_DEDUP_DUPLICATE = 1, // same ts_id as the last frame of the sender and socket id
+    AB_DEDUP_STALE = 2,     // older ts_id than the last frame of the sender and socket id
+};
+
+// last frame of a sender and socket id
+struct ab_dedup_entry
+{
+    uint32_t nad = 0;     // sender NAD
+    uint32_t time = 0;    // time of the last new frame in ms
+    uint16_t ts_id = 0;   // ts_id of the last new frame
+    uint8_t sock_id = 0;  // socket id
+    uint8_t used = 0;     // 1 = entry in use
+};
+
+/**
+ * table of the last ts_id per (sender NAD, socket id) in a buffer of the caller (open addressing, no heap allocation)
+ * a sender is looked up in at most AB_DEDUP_PROBES entries, a full probe range replaces its oldest sender
+ * frames with ts_id 0 are never suppressed, a sender which was silent for longer than the timeout starts again
+ * usage:
+ *   ab_dedup_entry dedupBuf[1024];
+ *   ab_dedup dedup(dedupBuf, 1024);
+ *   abSock.setDedup(&dedup);
+ */
+class ab_dedup
+{
+public:
+    /**
+     * constructor
+     * @param buffer table entries, it has to outlive the table
+     * @param count amount of entries in the buffer (power of two, about twice the amount of senders * socket ids)
+     * @param timeoutMs a sender which was silent for longer is accepted with any ts_id (0 = no timeout)
+     */
+    ab_dedup(ab_dedup_entry *buffer, uint16_t count, uint32_t timeoutMs = 10000) : m_buf(count > 0 ? buffer : NULL), m_timeout(timeoutMs)
+    {
+        // a size which is no power of two uses the largest power of two below it
+        uint32_t size = 1;
+        while (size * 2 <= count)
+            size *= 2;
+        m_mask = size - 1;
+        clear();
+    }
+    /**
+     * check a received frame and remember its ts_id if it is new
+     * @param nad sender NAD
+     * @param sock_id socket id
+     * @param ts_id ts_id of the frame
+     * @param now current time in ms
+     * @return AB_DEDUP_NEW = frame has to be handled, otherwise the reason of the drop
+     */
+    ab_dedup_result check(uint32_t nad, uint8_t sock_id, uint16_t ts_id, uint32_t now)
+    {
+        if (ts_id == 0 || m_buf == NULL)
+            return AB_DEDUP_NEW;
+        uint32_t pos = hash(nad, sock_id);
+        ab_dedup_entry *victim = NULL;
+        for (uint16_t i = 0; i < AB_DEDUP_PROBES && i <= m_mask; i++)
+        {
+            ab_dedup_entry &entry = m_buf[(pos + i) & m_mask];
+            // entries are never removed one by one, so the sender can not be behind a free entry
+            if (!entry.used)
+            {
+                victim = &entry;
+                break;
+            }
+            if (entry.nad == nad && entry.sock_id == sock_id)
+            {
+                if (m_timeout == 0 || (uint32_t)(now - entry.time) <= m_timeout)
+                {
+                    int16_t step = (int16_t)(uint16_t)(ts_id - entry.ts_id);
+                    if (step == 0)
+                        return AB_DEDUP_DUPLICATE;
+                    if (step < 0 && step >= -AB_DEDUP_WINDOW)
+                        return AB_DEDUP_STALE;
+                }
+                entry.ts_id = ts_id;
+                entry.time = now;
+                return AB_DEDUP_NEW;
+            }
+            if (victim == NULL || (int32_t)(entry.time - victim->time) < 0)
+                victim = &entry;
+        }
+        victim->nad = nad;
+        victim->sock_id = sock_id;
+        victim->ts_id = ts_id;
+        victim->time = now;
+        victim->used = 1;
+        return AB_DEDUP_NEW;
+    }
+    /**
+     * forget all senders
+     */
+    void clear()
+    {
+        if (m_buf == NULL)
+            return;
+        for (uint32_t i = 0; i <= m_mask; i++)
+            m_buf[i] = ab_dedup_entry();
+    }
+    /**
+     * @return amount of tracked senders and socket ids
+     */
+    uint16_t size() const
+    {
+        uint16_t retval = 0;
+        if (m_buf != NULL)
+        {
+            for (uint32_t i = 0; i <= m_mask; i++)
+                retval += m_buf[i].used;
+        }
+        return retval;
+    }
+
+private:
+    ab_dedup_entry *m_buf;
+    uint32_t m_mask = 0;
+    uint32_t m_timeout;
+    /**
+     * @param nad sender NAD
+     * @param sock_id socket id
+     * @return first probed entry
+     */
+    uint32_t hash(uint32_t nad, uint8_t sock_id) const
+    {
+        // multiplicative hash, the NADs of one site often only differ in the low bits
+        return ((nad ^ (uint32_t)sock_id << 24) * 0x9E3779B1u) >> 16;
+    }
+};
+
+#endif
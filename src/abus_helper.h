@@ -9,8 +9,10 @@
 
 // Uncomment/comment to turn on/off debug output messages.
 //#define ABUS_DEBUG
-// Uncomment/comment to turn on/off error output messages.
+// Uncomment/comment to turn on/off error output messages (or define ABUS_NO_ERROR before the include).
+#ifndef ABUS_NO_ERROR
 #define ABUS_ERROR
+#endif
 
 // Set where debug messages will be printed.
 #define ABUS_DBG_PRINTER Serial
@@ -68,7 +70,29 @@
 #endif
 
 #include <vector>
+#include <array>
+#include <string.h>
+#if defined(ARDUINO)
 #include "Arduino.h"
+#else
+#include "abus_host.h"
+#endif
+#include "abus_codec.h"
+
+#ifndef MAX_DATA_LEN
+#define MAX_DATA_LEN 255
+#endif
+// maximum amount of tag data bytes in a single socket frame (frame without header, dir, typ, ts_id and crc)
+#define AB_MAX_SOCKET_DATA (MAX_DATA_LEN - 18)
+
+// simd instruction set of the block wise crc calculation (define AB_CRC_NO_SIMD to use the portable version)
+#if !defined(AB_CRC_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+#include <emmintrin.h>
+#define AB_CRC_SSE2 1
+#elif !defined(AB_CRC_NO_SIMD) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#include <arm_neon.h>
+#define AB_CRC_NEON 1
+#endif
 // Primtable for CRC calculation
 const uint16_t ab_PrimTable[16] = {0x049D, 0x0C07, 0x1591, 0x1ACF, 0x1D4B, 0x202D, 0x2507, 0x2B4B,
                                    0x34A5, 0x38C5, 0x3D3F, 0x4445, 0x4D0F, 0x538F, 0x5FB3, 0x6BBF};
@@ -103,26 +127,274 @@ struct ab_socket
     std::vector<float_t> realdata;
 };
 
-// helper union for converting 4 bytes into one real value and vice versa
-union ab_real {
-    float_t real;
-    char bytes[sizeof(float_t)];
-} ab_real;
-// helper union for converting 2 bytes into one integer value and vice versa
-union ab_int {
-    byte b[sizeof(int16_t)];
-    int16_t i;
-} ab_int;
-// helper union for converting 4 bytes into one long value and vice versa
-union ab_long {
-    byte b[sizeof(int32_t)];
-    int32_t l;
-} ab_long;
-// helper union for converting 4 bytes into one unsigned integer value and vice versa (not used in socket)
-union ab_ulong {
-    byte b[sizeof(uint32_t)];
-    uint32_t ul;
-} ab_ulong;
+/**
+ * tag storage of ab_fixed_socket: one data area shared by the four tag sections
+ * the sections follow each other without gaps in the order longs, reals, ints, bits,
+ * so every section starts aligned to its element size
+ */
+struct ab_fixed_area
+{
+    // sections in the order of the area
+    enum : uint8_t
+    {
+        LONGS = 0,
+        REALS = 1,
+        INTS = 2,
+        BITS = 3,
+    };
+    uint16_t count[4] = {};                // amount of elements per section
+    alignas(4) char bytes[AB_MAX_SOCKET_DATA]; // tag data of all sections
+
+    /**
+     * @param section section of the area
+     * @return size of an element of the section in bytes
+     */
+    static constexpr size_t elementSize(uint8_t section)
+    {
+        return section <= REALS ? 4 : section == INTS ? 2 : 1;
+    }
+    /**
+     * @param section section of the area (4 = end of the used part)
+     * @return position of the section in bytes
+     */
+    size_t offset(uint8_t section) const
+    {
+        size_t retval = 0;
+        for (uint8_t i = 0; i < section; i++)
+            retval += count[i] * elementSize(i);
+        return retval;
+    }
+    /**
+     * change the amount of elements of a section, the following sections are moved
+     * @param section section of the area
+     * @param newCount new amount of elements (limited to the free space)
+     * @return new amount of elements
+     */
+    size_t resize(uint8_t section, size_t newCount)
+    {
+        size_t size = elementSize(section);
+        size_t used = offset(4);
+        size_t maxCount = count[section] + (AB_MAX_SOCKET_DATA - used) / size;
+        if (newCount > maxCount)
+            newCount = maxCount;
+        if (newCount != count[section])
+        {
+            size_t next = offset(section + 1);
+            size_t moved = next - count[section] * size + newCount * size;
+            memmove(bytes + moved, bytes + next, used - next);
+            count[section] = (uint16_t)newCount;
+        }
+        return newCount;
+    }
+};
+
+/**
+ * vector like section of an ab_fixed_area, its capacity is the free space of the area
+ * growing or shrinking a section moves the following sections of the area, which invalidates their pointers and references
+ * there is no range check on element access
+ */
+template <typename T, uint8_t S>
+class ab_fixed_section
+{
+public:
+    static_assert(sizeof(T) == ab_fixed_area::elementSize(S), "element type does not match the section");
+    explicit ab_fixed_section(ab_fixed_area &area) : m_area(&area) {}
+    // the section belongs to the area of its socket
+    ab_fixed_section(const ab_fixed_section &) = delete;
+    ab_fixed_section &operator=(const ab_fixed_section &) = delete;
+    size_t size() const { return m_area->count[S]; }
+    size_t capacity() const { return size() + (AB_MAX_SOCKET_DATA - m_area->offset(4)) / sizeof(T); }
+    size_t max_size() const { return capacity(); }
+    bool empty() const { return size() == 0; }
+    void clear() { m_area->resize(S, 0); }
+    /**
+     * change the amount of elements, new elements are set to the given value
+     * @param count new amount of elements (limited to the capacity)
+     * @param value value of the added elements
+     */
+    void resize(size_t count, const T &value = T())
+    {
+        size_t pos = size();
+        count = m_area->resize(S, count);
+        T *values = data();
+        while (pos < count)
+            values[pos++] = value;
+    }
+    /**
+     * add an element at the end
+     * @param value value to add
+     * @return true = added, false = capacity exceeded
+     */
+    bool push_back(const T &value)
+    {
+        size_t pos = size();
+        if (m_area->resize(S, pos + 1) == pos)
+            return false;
+        data()[pos] = value;
+        return true;
+    }
+    T &operator[](size_t pos) { return data()[pos]; }
+    const T &operator[](size_t pos) const { return data()[pos]; }
+    T &at(size_t pos) { return data()[pos]; }
+    const T &at(size_t pos) const { return data()[pos]; }
+    T *data() { return reinterpret_cast<T *>(m_area->bytes + m_area->offset(S)); }
+    const T *data() const { return reinterpret_cast<const T *>(m_area->bytes + m_area->offset(S)); }
+    T *begin() { return data(); }
+    T *end() { return data() + size(); }
+    const T *begin() const { return data(); }
+    const T *end() const { return data() + size(); }
+
+private:
+    ab_fixed_area *m_area;
+};
+
+// abus socket structure with inline tag storage for the largest socket that fits into MAX_DATA_LEN
+// it has the same members as ab_socket, but receiving, forwarding and sending it never touches the heap;
+// the tag sections share one area of AB_MAX_SOCKET_DATA bytes, so all tags of a socket frame fit together
+struct ab_fixed_socket
+{
+    ab_socket_config config;
+    uint32_t sender = 0;
+    bool socket_valid = false;
+
+private:
+    ab_fixed_area m_area; // constructed before the sections which point to it
+
+public:
+    ab_fixed_section<uint8_t, ab_fixed_area::BITS> bitdata{m_area};
+    ab_fixed_section<int16_t, ab_fixed_area::INTS> intdata{m_area};
+    ab_fixed_section<int32_t, ab_fixed_area::LONGS> longdata{m_area};
+    ab_fixed_section<float_t, ab_fixed_area::REALS> realdata{m_area};
+
+    ab_fixed_socket() = default;
+    // the copy gets its own area, the sections keep pointing to it
+    ab_fixed_socket(const ab_fixed_socket &other) : config(other.config), sender(other.sender), socket_valid(other.socket_valid), m_area(other.m_area) {}
+    ab_fixed_socket &operator=(const ab_fixed_socket &other)
+    {
+        config = other.config;
+        sender = other.sender;
+        socket_valid = other.socket_valid;
+        m_area = other.m_area;
+        return *this;
+    }
+};
+
+// state of an incremental crc calculation
+struct ab_crc_state
+{
+    uint16_t crc = 0; // sum of the already processed bytes
+    uint8_t pos = 0;  // position of the next byte in the frame modulo 16 (index of its prime)
+};
+
+/**
+ * Calculates the checksum sum of whole 16 byte blocks, the first byte of each block uses the first prime
+ * @param data pointer to data buffer
+ * @param blocks amount of 16 byte blocks
+ * @return checksum sum of the blocks
+ */
+inline uint16_t ab_calcCRCBlocks(const uint8_t *data, size_t blocks)
+{
+#if defined(AB_CRC_SSE2)
+    // 8 products per 16 bit lane, the lanes wrap around modulo 2^16 just like the checksum
+    const __m128i prim_lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ab_PrimTable));
+    const __m128i prim_hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ab_PrimTable + 8));
+    const __m128i key = _mm_set1_epi8(0x5A);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = zero;
+    while (blocks-- > 0)
+    {
+        __m128i b = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data)), key);
+        acc = _mm_add_epi16(acc, _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), prim_lo));
+        acc = _mm_add_epi16(acc, _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), prim_hi));
+        data += 16;
+    }
+    acc = _mm_add_epi16(acc, _mm_srli_si128(acc, 8));
+    acc = _mm_add_epi16(acc, _mm_srli_si128(acc, 4));
+    acc = _mm_add_epi16(acc, _mm_srli_si128(acc, 2));
+    return static_cast<uint16_t>(_mm_cvtsi128_si32(acc));
+#elif defined(AB_CRC_NEON)
+    const uint16x8_t prim_lo = vld1q_u16(ab_PrimTable);
+    const uint16x8_t prim_hi = vld1q_u16(ab_PrimTable + 8);
+    const uint8x16_t key = vdupq_n_u8(0x5A);
+    uint16x8_t acc = vdupq_n_u16(0);
+    while (blocks-- > 0)
+    {
+        uint8x16_t b = veorq_u8(vld1q_u8(data), key);
+        acc = vmlaq_u16(acc, vmovl_u8(vget_low_u8(b)), prim_lo);
+        acc = vmlaq_u16(acc, vmovl_u8(vget_high_u8(b)), prim_hi);
+        data += 16;
+    }
+    uint16_t lanes[8];
+    vst1q_u16(lanes, acc);
+    return static_cast<uint16_t>(lanes[0] + lanes[1] + lanes[2] + lanes[3] + lanes[4] + lanes[5] + lanes[6] + lanes[7]);
+#else
+    // unrolled, the primes are constants and the sum only needs to be truncated once at the end
+    uint32_t crc = 0;
+    while (blocks-- > 0)
+    {
+        crc += (data[0] ^ 0x5Au) * 0x049Du + (data[1] ^ 0x5Au) * 0x0C07u + (data[2] ^ 0x5Au) * 0x1591u + (data[3] ^ 0x5Au) * 0x1ACFu +
+               (data[4] ^ 0x5Au) * 0x1D4Bu + (data[5] ^ 0x5Au) * 0x202Du + (data[6] ^ 0x5Au) * 0x2507u + (data[7] ^ 0x5Au) * 0x2B4Bu +
+               (data[8] ^ 0x5Au) * 0x34A5u + (data[9] ^ 0x5Au) * 0x38C5u + (data[10] ^ 0x5Au) * 0x3D3Fu + (data[11] ^ 0x5Au) * 0x4445u +
+               (data[12] ^ 0x5Au) * 0x4D0Fu + (data[13] ^ 0x5Au) * 0x538Fu + (data[14] ^ 0x5Au) * 0x5FB3u + (data[15] ^ 0x5Au) * 0x6BBFu;
+        data += 16;
+    }
+    return static_cast<uint16_t>(crc);
+#endif
+}
+
+/**
+ * Starts an incremental checksum calculation at the first byte of a packet
+ * @param state crc state
+ */
+inline void ab_crcInit(ab_crc_state &state)
+{
+    state.crc = 0;
+    state.pos = 0;
+}
+
+/**
+ * Adds the next bytes of the packet to an incremental checksum calculation
+ * @param state crc state
+ * @param data pointer to data buffer
+ * @param datalen amount of bytes
+ */
+inline void ab_crcUpdate(ab_crc_state &state, const char *data, size_t datalen)
+{
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(data);
+    uint16_t crc = state.crc;
+    uint8_t pos = state.pos;
+    while (datalen > 0)
+    {
+        if (pos == 0 && datalen >= 16)
+        {
+            size_t blocks = datalen >> 4;
+            crc += ab_calcCRCBlocks(p, blocks);
+            p += blocks << 4;
+            datalen &= 0x0F;
+            continue;
+        }
+        // partial block up to the next block boundary
+        size_t count = 16u - pos;
+        if (count > datalen)
+            count = datalen;
+        for (size_t i = 0; i < count; i++)
+            crc += static_cast<uint16_t>((p[i] ^ 0x5A) * ab_PrimTable[pos + i]);
+        p += count;
+        datalen -= count;
+        pos = (pos + count) & 0x0F;
+    }
+    state.crc = crc;
+    state.pos = pos;
+}
+
+/**
+ * @param state crc state
+ * @return checksum of all bytes added to the state
+ */
+inline uint16_t ab_crcFinal(const ab_crc_state &state)
+{
+    return state.crc;
+}
 
 /**
  * Calculates the Checksum of the packet
@@ -130,16 +402,11 @@ union ab_ulong {
  * @param datalen data length on which the crc shall be calculated
  * @return calculated crc value 
  */
-uint16_t ab_calcCRC(char *data, size_t datalen)
+inline uint16_t ab_calcCRC(const char *data, size_t datalen)
 {
-    uint16_t crc = 0;
-    size_t index = 0;
-    while (index < datalen)
-    {
-        crc += static_cast<uint16_t>(((data[index] ^ 0x5A) * ab_PrimTable[index & 0x0F]) & 0xFFFF);
-        index++;
-    }
-    return crc;
+    ab_crc_state state;
+    ab_crcUpdate(state, data, datalen);
+    return ab_crcFinal(state);
 }
 
 /**
@@ -149,13 +416,9 @@ uint16_t ab_calcCRC(char *data, size_t datalen)
  * @param pos position of bool(ean) data in data buffer
  * @return bool(ean) data value
  */
-bool ab_getBoolVal(char *data, size_t len, uint16_t pos)
+inline bool ab_getBoolVal(const char *data, size_t len, uint16_t pos)
 {
-    if (len >= pos)
-    {
-        return data[pos] > 0;
-    }
-    return false;
+    return pos < len && data[pos] != 0;
 }
 
 /**
@@ -165,15 +428,9 @@ bool ab_getBoolVal(char *data, size_t len, uint16_t pos)
  * @param pos start position of integer data in data buffer
  * @return integer data value
  */
-int16_t ab_getIntVal(char *data, size_t len, uint16_t pos)
+inline int16_t ab_getIntVal(const char *data, size_t len, uint16_t pos)
 {
-    int16_t retval = 0;
-    if (len >= pos + 1u)
-    {
-        retval = data[pos];
-        retval += data[pos + 1] << 8;
-    }
-    return retval;
+    return pos + 2u <= len ? ab_loadI16(data + pos) : 0;
 }
 
 /**
@@ -183,15 +440,9 @@ int16_t ab_getIntVal(char *data, size_t len, uint16_t pos)
  * @param pos start position of unsigned integer data in data buffer
  * @return unsigned integer data value
  */
-uint16_t ab_getUIntVal(char *data, size_t len, uint16_t pos)
+inline uint16_t ab_getUIntVal(const char *data, size_t len, uint16_t pos)
 {
-    uint16_t retval = 0;
-    if (len >= pos + 1u)
-    {
-        retval = data[pos];
-        retval += data[pos + 1] << 8;
-    }
-    return retval;
+    return pos + 2u <= len ? ab_loadU16(data + pos) : 0;
 }
 
 /**
@@ -201,17 +452,9 @@ uint16_t ab_getUIntVal(char *data, size_t len, uint16_t pos)
  * @param pos start position of long data in data buffer
  * @return long data value
  */
-int32_t ab_getLongVal(char *data, size_t len, uint16_t pos)
+inline int32_t ab_getLongVal(const char *data, size_t len, uint16_t pos)
 {
-    int32_t retval = 0;
-    if (len >= pos + 3u)
-    {
-        retval = data[pos];
-        retval += data[pos + 1] << 8;
-        retval += data[pos + 2] << 16;
-        retval += data[pos + 3] << 24;
-    }
-    return retval;
+    return pos + 4u <= len ? ab_loadI32(data + pos) : 0;
 }
 
 /**
@@ -221,17 +464,9 @@ int32_t ab_getLongVal(char *data, size_t len, uint16_t pos)
  * @param pos start position of unsigned long data in data buffer
  * @return unsigned long data value
  */
-uint32_t ab_getULongVal(char *data, size_t len, uint16_t pos)
+inline uint32_t ab_getULongVal(const char *data, size_t len, uint16_t pos)
 {
-    uint32_t retval = 0;
-    if (len >= pos + 3u)
-    {
-        retval = data[pos];
-        retval += data[pos + 1] << 8;
-        retval += data[pos + 2] << 16;
-        retval += data[pos + 3] << 24;
-    }
-    return retval;
+    return pos + 4u <= len ? ab_loadU32(data + pos) : 0;
 }
 
 /**
@@ -241,17 +476,9 @@ uint32_t ab_getULongVal(char *data, size_t len, uint16_t pos)
  * @param pos start position of real / float data in data buffer
  * @return real / float data value
  */
-float_t ab_getRealVal(char *data, size_t len, uint16_t pos)
+inline float_t ab_getRealVal(const char *data, size_t len, uint16_t pos)
 {
-    ab_real.real = 0.0;
-    if (len >= pos + 3u)
-    {
-        ab_real.bytes[0] = data[pos];
-        ab_real.bytes[1] = data[pos + 1];
-        ab_real.bytes[2] = data[pos + 2];
-        ab_real.bytes[3] = data[pos + 3];
-    }
-    return ab_real.real;
+    return pos + 4u <= len ? ab_loadReal(data + pos) : 0.0f;
 }
 
 /**
@@ -261,28 +488,22 @@ float_t ab_getRealVal(char *data, size_t len, uint16_t pos)
  * @param pos start position of real / float data in data buffer
  * @param val real / float data value
  */
-void ab_setRealVal(char *data, size_t len, uint16_t pos, float_t val)
+inline void ab_setRealVal(char *data, size_t len, uint16_t pos, float_t val)
 {
-    ab_real.real = val;
-    if (len >= pos + 3u)
-    {
-        data[pos] = ab_real.bytes[0];
-        data[pos + 1] = ab_real.bytes[1];
-        data[pos + 2] = ab_real.bytes[2];
-        data[pos + 3] = ab_real.bytes[3];
-    }
+    if (pos + 4u <= len)
+        ab_storeReal(data + pos, val);
 }
 
 /**
  * write bool(ean) value into the packet buffer
  * @param data pointer to data buffer
  * @param len maximum length of data buffer
- * @param pos start position of real / float data in data buffer
+ * @param pos position of bool(ean) data in data buffer
  * @param val bool(ean) data value
  */
-void ab_setBoolVal(char *data, size_t len, uint16_t pos, bool val)
+inline void ab_setBoolVal(char *data, size_t len, uint16_t pos, bool val)
 {
-    if (len >= pos)
+    if (pos < len)
         data[pos] = (char)val;
 }
 
@@ -290,103 +511,123 @@ void ab_setBoolVal(char *data, size_t len, uint16_t pos, bool val)
  * write integer value into the packet buffer
  * @param data pointer to data buffer
  * @param len maximum length of data buffer
- * @param pos start position of real / float data in data buffer
+ * @param pos start position of integer data in data buffer
  * @param val integer data value
  */
-void ab_setIntVal(char *data, size_t len, uint16_t pos, int16_t val)
+inline void ab_setIntVal(char *data, size_t len, uint16_t pos, int16_t val)
 {
-    if (len >= pos + 1u)
-    {
-        data[pos] = (char)(val & 0xFF);
-        data[pos + 1] = (char)(val >> 8);
-    }
+    if (pos + 2u <= len)
+        ab_storeU16(data + pos, (uint16_t)val);
 }
 
 /**
  * write unsigned integer value into the packet buffer
  * @param data pointer to data buffer
  * @param len maximum length of data buffer
- * @param pos start position of real / float data in data buffer
+ * @param pos start position of unsigned integer data in data buffer
  * @param val unsigned integer data value
  */
-void ab_setUIntVal(char *data, size_t len, uint16_t pos, uint16_t val)
+inline void ab_setUIntVal(char *data, size_t len, uint16_t pos, uint16_t val)
 {
-    if (len >= pos + 1u)
-    {
-        data[pos] = (char)(val & 0xFF);
-        data[pos + 1] = (char)(val >> 8);
-    }
+    if (pos + 2u <= len)
+        ab_storeU16(data + pos, val);
 }
 
 /**
  * write long value into the packet buffer
  * @param data pointer to data buffer
  * @param len maximum length of data buffer
- * @param pos start position of real / float data in data buffer
+ * @param pos start position of long data in data buffer
  * @param val long data value
  */
-void ab_setLongVal(char *data, size_t len, uint16_t pos, int32_t val)
+inline void ab_setLongVal(char *data, size_t len, uint16_t pos, int32_t val)
 {
-    if (len >= pos + 3u)
-    {
-        ab_long.l = val;
-        data[pos] = ab_long.b[0];
-        data[pos + 1] = ab_long.b[1];
-        data[pos + 2] = ab_long.b[2];
-        data[pos + 3] = ab_long.b[3];
-    }
+    if (pos + 4u <= len)
+        ab_storeU32(data + pos, (uint32_t)val);
 }
 
 /**
  * write unsigned long value into the packet buffer
  * @param data pointer to data buffer
  * @param len maximum length of data buffer
- * @param pos start position of real / float data in data buffer
+ * @param pos start position of unsigned long data in data buffer
  * @param val unsigned long data value
  */
-void ab_setULongVal(char *data, size_t len, uint16_t pos, uint32_t val)
+inline void ab_setULongVal(char *data, size_t len, uint16_t pos, uint32_t val)
 {
-    if (len >= pos + 3u)
-    {
-        ab_ulong.ul = val;
-        data[pos] = ab_ulong.b[0];
-        data[pos + 1] = ab_ulong.b[1];
-        data[pos + 2] = ab_ulong.b[2];
-        data[pos + 3] = ab_ulong.b[3];
-    }
+    if (pos + 4u <= len)
+        ab_storeU32(data + pos, val);
 }
 
+// result of the check of a received packet
+enum ab_packet_check : uint8_t
+{
+    AB_PACKET_OK = 0,     // valid packet
+    AB_PACKET_SHORT = 1,  // shorter than header and checksum
+    AB_PACKET_MAGIC = 2,  // does not start with AA 55
+    AB_PACKET_LENGTH = 3, // length field does not match the packet length
+    AB_PACKET_CRC = 4,    // wrong checksum
+};
+
 /**
- * checks the received packet if it is valid
+ * checks the start of a received packet before the rest of it is read (magic and length field, no checksum)
+ * @param data pointer to the first 4 bytes of the packet
+ * @param datalen length of the whole (received) packet
+ * @return AB_PACKET_OK = the rest of the packet has to be checked with ab_checkPacket(), otherwise the reason of the drop
+ */
+inline ab_packet_check ab_checkPacketHead(const char *data, size_t datalen)
+{
+    if (datalen <= 12 + 2)
+        return AB_PACKET_SHORT;
+    if ((uint8_t)data[0] != 0xAA || (uint8_t)data[1] != 0x55)
+        return AB_PACKET_MAGIC;
+    if (datalen != ab_loadU16(data + 2) + 14u)
+        return AB_PACKET_LENGTH;
+    return AB_PACKET_OK;
+}
+
+/**
+ * checks the received packet and reports why it is invalid
  * @param data pointer to data buffer
  * @param datalen length of (received) data packet
+ * @return AB_PACKET_OK or the reason of the drop
  */
-bool ab_checkValidPacket(char *data, size_t datalen)
+inline ab_packet_check ab_checkPacket(const char *data, size_t datalen)
 {
     if (datalen > 12 + 2)
     {
         // first check for valid header
-        if (data[0] != 0xAA || data[1] != 0x55)
+        if ((uint8_t)data[0] != 0xAA || (uint8_t)data[1] != 0x55)
         {
             ABUS_ERR_PRINTLN(F("*AB: checkValidPacket()-> invalid header!"));
-            return false;
+            return AB_PACKET_MAGIC;
         }
         // check for valid datalength
         if (datalen != (ab_getUIntVal(data, datalen, 2) + 14u))
         {
             ABUS_ERR_PRINTLN(F("*AB: checkValidPacket()-> invalid packet length!"));
-            return false;
+            return AB_PACKET_LENGTH;
         }
         // check for falid checksum
         if (ab_calcCRC(data, datalen - 2) != ab_getUIntVal(data, datalen, datalen - 2))
         {
             ABUS_ERR_PRINTLN(F("*AB: checkValidPacket()-> invalid crc!"));
-            return false;
+            return AB_PACKET_CRC;
         }
-        return true;
+        return AB_PACKET_OK;
     }
     ABUS_ERR_PRINTLN(F("*AB: checkValidPacket()-> length too short!"));
-    return false;
+    return AB_PACKET_SHORT;
+}
+
+/**
+ * checks the received packet if it is valid
+ * @param data pointer to data buffer
+ * @param datalen length of (received) data packet
+ */
+inline bool ab_checkValidPacket(const char *data, size_t datalen)
+{
+    return ab_checkPacket(data, datalen) == AB_PACKET_OK;
 }
 
 /**
@@ -394,16 +635,16 @@ bool ab_checkValidPacket(char *data, size_t datalen)
  * @param data pointer to data buffer
  * @param datalen maximum data length of data buffer
  */
-ab_header ab_getHeader(char *data, size_t datalen)
+inline ab_header ab_getHeader(const char *data, size_t datalen)
 {
     ab_header retval;
     retval.len = ab_getUIntVal(data, datalen, 2);
     retval.from = ab_getULongVal(data, datalen, 4);
     retval.to = ab_getULongVal(data, datalen, 8);
     if (retval.len > 2u)
-        retval.dir = data[12];
+        retval.dir = (uint8_t)data[12];
     if (retval.len > 3u)
-        retval.typ = data[13];
+        retval.typ = (uint8_t)data[13];
     if (retval.len > 4u)
         retval.ts_id = ab_getUIntVal(data, datalen, datalen - 4);
     return retval;
@@ -415,37 +656,84 @@ ab_header ab_getHeader(char *data, size_t datalen)
  * @param len maximum data length of data buffer
  * @param header abus header structure which sall be added to data buffer
  */
-void ab_setHeader(char *data, size_t len, ab_header header)
+inline void ab_setHeader(char *data, size_t len, ab_header header)
 {
-    if (len > header.len + 14u)
+    if (len >= header.len + 14u)
     {
         ABUS_DBG_PRINTF("*AB: setHeader()->len=%d, from=%u, to=%u\n", header.len, header.from, header.to);
-        data[0] = 0xAA;
+        data[0] = (char)0xAA;
         data[1] = 0x55;
         ab_setUIntVal(data, len, 2, header.len);
         ab_setULongVal(data, len, 4, header.from);
         ab_setULongVal(data, len, 8, header.to);
-        data[12] = header.dir;
-        data[13] = header.typ;
+        data[12] = (char)header.dir;
+        data[13] = (char)header.typ;
         ab_setUIntVal(data, len, header.len + 10u, header.ts_id);
     }
 }
 
 /**
- * with this function it is possible to parse a received package for valid socket data
+ * calculates the expected header length of a socket with the given configuration
+ * @param sock_conf structure with socket configuraton
+ * @return header.len a received socket frame must have
+ */
+inline uint16_t ab_getSocketLen(const ab_socket_config &sock_conf)
+{
+    return sock_conf.bitcount + sock_conf.intcount * 2 + sock_conf.longcount * 4 + sock_conf.realcount * 4 + 4;
+}
+
+/**
+ * check if the tags of a socket configuration fit into the inline storage of ab_fixed_socket
+ * @param sock_conf socket configuration
+ * @return true = fits
+ */
+inline bool ab_fitsFixedSocket(const ab_socket_config &sock_conf)
+{
+    return ab_getSocketLen(sock_conf) - 4u <= AB_MAX_SOCKET_DATA;
+}
+
+/**
+ * check if tags fit into the storage of a socket structure
+ * @param socket socket structure (ab_socket grows on demand)
+ * @param sock_conf socket configuration
+ * @return true = fits
+ */
+inline bool ab_fitsSocketStorage(const ab_socket &socket, const ab_socket_config &sock_conf)
+{
+    (void)socket;
+    (void)sock_conf;
+    return true;
+}
+
+/**
+ * check if tags fit into the storage of a socket structure
+ * @param socket socket structure with inline storage
+ * @param sock_conf socket configuration
+ * @return true = fits
+ */
+inline bool ab_fitsSocketStorage(const ab_fixed_socket &socket, const ab_socket_config &sock_conf)
+{
+    (void)socket;
+    return ab_fitsFixedSocket(sock_conf);
+}
+
+/**
+ * parse a received package for valid socket data into an existing socket structure (ab_socket or ab_fixed_socket)
  * @param data pointer to data buffer
  * @param datalen maximum data length of data buffer
  * @param header pointer to abus socket header
- * @param sock_id socket id no
+ * @param sock_id socket id no (0 = any socket)
  * @param bitcount amount of bool(ean) tags in socket
  * @param intcount amount of int tags in socket
  * @param longcount amount of long tags in socket
  * @param realcount amount of real tags in socket
- * @return parsed abus socket (empty / null if no socket)
+ * @param retval socket structure which receives the tag data
+ * @return true = valid socket data parsed
  */
-ab_socket ab_getSocket(char *data, size_t datalen, ab_header &header, uint8_t sock_id = 0, uint8_t bitcount = 0, uint8_t intcount = 0, uint8_t longcount = 0, uint8_t realcount = 0)
+template <class S>
+bool ab_getSocketData(const char *data, size_t datalen, const ab_header &header, uint8_t sock_id, uint8_t bitcount, uint8_t intcount, uint8_t longcount, uint8_t realcount, S &retval)
 {
-    ab_socket retval;
+    retval.socket_valid = false;
     // check if we had a socket message
     if (((header.typ > 0 && sock_id == 0) || (header.typ == sock_id)) && header.dir == 1)
     {
@@ -455,59 +743,75 @@ ab_socket ab_getSocket(char *data, size_t datalen, ab_header &header, uint8_t so
         ABUS_DBG_PRINTF("*AB: getSocket()->id=%d, sender=%u, header.len=%d", retval.config.socket_id, retval.sender, header.len);
         uint16_t pos = 14;
         // check for valid length of data block
-        if (header.len != (bitcount + intcount * 2 + longcount * 4 + realcount * 4 + 4))
+        if (header.len != (bitcount + intcount * 2 + longcount * 4 + realcount * 4 + 4) || header.len + 14u > datalen)
         {
             ABUS_ERR_PRINTLN(F("*AB: getSocket()->amount of variables wrong!"));
-            return retval;
+            return false;
         }
-        uint8_t slotpos = 0;
-        //retval.bitdata.resize(bitcount, false);
-        retval.bitdata.resize(bitcount, false);
-        while (bitcount > slotpos)
+        // the inline storage of ab_fixed_socket would clamp the tags
+        ab_socket_config conf;
+        conf.bitcount = bitcount;
+        conf.intcount = intcount;
+        conf.longcount = longcount;
+        conf.realcount = realcount;
+        if (!ab_fitsSocketStorage(retval, conf))
         {
-            retval.bitdata[slotpos] = data[pos] > 0;
-            ABUS_DBG_PRINTF(", b%d=%d", slotpos, retval.bitdata[slotpos]);
-            pos++;
-            slotpos++;
+            ABUS_ERR_PRINTLN(F("*AB: getSocket()->too many variables for the socket storage!"));
+            return false;
         }
-        slotpos = 0;
+        // the tag sections are decoded as a whole, the sections of ab_fixed_socket share one area,
+        // so all of them are emptied before the first one grows
+        retval.bitdata.clear();
+        retval.intdata.clear();
+        retval.longdata.clear();
+        retval.realdata.clear();
+        retval.bitdata.resize(bitcount, 0);
+        ab_decodeBits(data + pos, retval.bitdata.data(), bitcount);
+        pos += bitcount;
         retval.intdata.resize(intcount, 0);
-        while (intcount > slotpos)
-        {
-            //retval.intdata.push_back(ab_getIntVal(data, datalen, pos));
-            retval.intdata[slotpos] = ab_getIntVal(data, datalen, pos);
-            ABUS_DBG_PRINTF(", i%d=%d", slotpos, retval.intdata[slotpos]);
-            pos += 2;
-            slotpos++;
-        }
-        slotpos = 0;
+        ab_decodeInts(data + pos, retval.intdata.data(), intcount);
+        pos += intcount * 2;
         retval.longdata.resize(longcount, 0);
-        while (longcount > slotpos)
-        {
-            //retval.longdata.push_back(ab_getLongVal(data, datalen, pos));
-            retval.longdata[slotpos] = ab_getLongVal(data, datalen, pos);
-            ABUS_DBG_PRINTF(", i%d=%d", slotpos, retval.longdata[slotpos]);
-            pos += 4;
-            slotpos++;
-        }
-        slotpos = 0;
+        ab_decodeLongs(data + pos, retval.longdata.data(), longcount);
+        pos += longcount * 4;
         retval.realdata.resize(realcount, 0.0);
-        while (realcount > slotpos)
-        {
-            //retval.realdata.push_back(ab_getRealVal(data, datalen, pos));
-            retval.realdata[slotpos] = ab_getRealVal(data, datalen, pos);
-            ABUS_DBG_PRINTF(", r%d=%.1f", slotpos, retval.realdata[slotpos]);
-            pos += 4;
-            slotpos++;
-        }
+        ab_decodeReals(data + pos, retval.realdata.data(), realcount);
+#ifdef ABUS_DEBUG
+        for (uint8_t i = 0; i < bitcount; i++)
+            ABUS_DBG_PRINTF(", b%d=%d", i, retval.bitdata[i]);
+        for (uint8_t i = 0; i < intcount; i++)
+            ABUS_DBG_PRINTF(", i%d=%d", i, retval.intdata[i]);
+        for (uint8_t i = 0; i < longcount; i++)
+            ABUS_DBG_PRINTF(", l%d=%d", i, retval.longdata[i]);
+        for (uint8_t i = 0; i < realcount; i++)
+            ABUS_DBG_PRINTF(", r%d=%.1f", i, retval.realdata[i]);
+#endif
         retval.config.bitcount  = bitcount;
         retval.config.intcount = intcount;
         retval.config.longcount = longcount;
         retval.config.realcount = realcount;
-        retval.config.socket_id = sock_id;
         retval.socket_valid = true;
         ABUS_DBG_PRINTLN("");
     }
+    return retval.socket_valid;
+}
+
+/**
+ * with this function it is possible to parse a received package for valid socket data
+ * @param data pointer to data buffer
+ * @param datalen maximum data length of data buffer
+ * @param header pointer to abus socket header
+ * @param sock_id socket id no
+ * @param bitcount amount of bool(ean) tags in socket
+ * @param intcount amount of int tags in socket
+ * @param longcount amount of long tags in socket
+ * @param realcount amount of real tags in socket
+ * @return parsed abus socket (empty / null if no socket)
+ */
+inline ab_socket ab_getSocket(const char *data, size_t datalen, ab_header &header, uint8_t sock_id = 0, uint8_t bitcount = 0, uint8_t intcount = 0, uint8_t longcount = 0, uint8_t realcount = 0)
+{
+    ab_socket retval;
+    ab_getSocketData(data, datalen, header, sock_id, bitcount, intcount, longcount, realcount, retval);
     return retval;
 }
 
@@ -519,54 +823,453 @@ ab_socket ab_getSocket(char *data, size_t datalen, ab_header &header, uint8_t so
  * @param sock_conf structure with socket configuraton
  * @return parsed abus socket (empty / null if no socket)
  */
-ab_socket ab_getSocket(char *data, size_t datalen, ab_header &header, ab_socket_config sock_conf)
+inline ab_socket ab_getSocket(const char *data, size_t datalen, ab_header &header, ab_socket_config sock_conf)
 {
     return ab_getSocket(data, datalen, header, sock_conf.socket_id, sock_conf.bitcount, sock_conf.intcount, sock_conf.longcount, sock_conf.realcount);
 }
 
+/**
+ * parse a received package for valid socket data into a socket with inline storage (no heap allocation)
+ * @param data pointer to data buffer
+ * @param datalen maximum data length of data buffer
+ * @param header pointer to abus socket header
+ * @param sock_conf structure with socket configuraton
+ * @param socket socket which receives the tag data
+ * @return true = valid socket data parsed
+ */
+inline bool ab_getSocket(const char *data, size_t datalen, const ab_header &header, const ab_socket_config &sock_conf, ab_fixed_socket &socket)
+{
+    return ab_getSocketData(data, datalen, header, sock_conf.socket_id, sock_conf.bitcount, sock_conf.intcount, sock_conf.longcount, sock_conf.realcount, socket);
+}
+
 /**
  * add all socket values into the data buffer
  * @param data pointer to data buffer
  * @param datalen maximum data buffer length
- * @param socket socket with tag data
+ * @param socket socket with tag data (ab_socket or ab_fixed_socket)
  */
-void ab_setSocket(char *data, size_t datalen, ab_socket socket)
+template <class S>
+void ab_setSocketData(char *data, size_t datalen, const S &socket)
 {
     ABUS_DBG_PRINTF("*AB: setSocket()->id=%d, sender=%d", socket.config.socket_id, socket.sender);
-    uint16_t pos = 14;
-    uint8_t slotpos = 0;
-    while (socket.bitdata.size() > slotpos)
+    size_t bits = socket.bitdata.size();
+    size_t ints = socket.intdata.size();
+    size_t longs = socket.longdata.size();
+    size_t reals = socket.realdata.size();
+    if (bits + ints * 2 + longs * 4 + reals * 4 + 14u > datalen)
+        return;
+    char *p = data + 14;
+    ab_encodeBits(socket.bitdata.data(), p, bits);
+    p += bits;
+    ab_encodeInts(socket.intdata.data(), p, ints);
+    p += ints * 2;
+    ab_encodeLongs(socket.longdata.data(), p, longs);
+    p += longs * 4;
+    ab_encodeReals(socket.realdata.data(), p, reals);
+    ABUS_DBG_PRINTLN("");
+}
+
+/**
+ * add all socket values into the data buffer
+ * @param data pointer to data buffer
+ * @param datalen maximum data buffer length
+ * @param socket socket with tag data
+ */
+inline void ab_setSocket(char *data, size_t datalen, const ab_socket &socket)
+{
+    ab_setSocketData(data, datalen, socket);
+}
+
+/**
+ * add all socket values into the data buffer
+ * @param data pointer to data buffer
+ * @param datalen maximum data buffer length
+ * @param socket socket with tag data
+ */
+inline void ab_setSocket(char *data, size_t datalen, const ab_fixed_socket &socket)
+{
+    ab_setSocketData(data, datalen, socket);
+}
+
+// lazy view on the tag data of a received socket frame
+// it points into the receive buffer and decodes a tag only when it is accessed,
+// so it is only valid as long as the receive buffer (e.g. inside the socket callback)
+struct ab_socket_view
+{
+    const char *frame = NULL; // checked frame buffer
+    ab_socket_config config;
+    uint32_t sender = 0;
+    // frame positions of the tag sections
+    uint16_t bit_pos = 14;
+    uint16_t int_pos = 14;
+    uint16_t long_pos = 14;
+    uint16_t real_pos = 14;
+
+    /**
+     * bool(ean) tag of the socket
+     * @param pos index of the bit tag
+     * @return tag value (false if out of range)
+     */
+    bool bit(uint8_t pos) const
     {
-        ABUS_DBG_PRINTF(", b%d=%d", slotpos, socket.bitdata[slotpos]);
-        data[pos] = socket.bitdata[slotpos];
-        pos++;
-        slotpos++;
+        if (pos >= config.bitcount)
+            return false;
+        return frame[bit_pos + pos] != 0;
     }
-    slotpos = 0;
-    while (socket.intdata.size() > slotpos)
+    /**
+     * integer tag of the socket
+     * @param pos index of the int tag
+     * @return tag value (0 if out of range)
+     */
+    int16_t i16(uint8_t pos) const
     {
-        ABUS_DBG_PRINTF(", i%d=%d", slotpos, socket.intdata[slotpos]);
-        ab_setIntVal(data, datalen, pos, socket.intdata[slotpos]);
-        pos += 2;
-        slotpos++;
+        if (pos >= config.intcount)
+            return 0;
+        return ab_loadI16(frame + int_pos + pos * 2);
     }
-    slotpos = 0;
-    while (socket.longdata.size() > slotpos)
+    /**
+     * long tag of the socket
+     * @param pos index of the long tag
+     * @return tag value (0 if out of range)
+     */
+    int32_t i32(uint8_t pos) const
     {
-        ABUS_DBG_PRINTF(", l%d=%d", slotpos, socket.longdata[slotpos]);
-        ab_setLongVal(data, datalen, pos, socket.longdata[slotpos]);
-        pos += 4;
-        slotpos++;
+        if (pos >= config.longcount)
+            return 0;
+        return ab_loadI32(frame + long_pos + pos * 4);
     }
-    slotpos = 0;
-    while (socket.realdata.size() > slotpos)
+    /**
+     * real tag of the socket
+     * @param pos index of the real tag
+     * @return tag value (0.0 if out of range)
+     */
+    float_t real(uint8_t pos) const
     {
-        ABUS_DBG_PRINTF(", f%d=%.1f", slotpos, socket.realdata[slotpos]);
-        ab_setRealVal(data, datalen, pos, socket.realdata[slotpos]);
-        pos += 4;
-        slotpos++;
+        if (pos >= config.realcount)
+            return 0.0f;
+        return ab_loadReal(frame + real_pos + pos * 4);
     }
-    ABUS_DBG_PRINTLN("");
+};
+
+/**
+ * create a lazy view on the socket data of a received package without decoding any tag
+ * @param data pointer to the checked data buffer
+ * @param datalen length of the data buffer
+ * @param header abus socket header
+ * @param sock_conf structure with socket configuraton
+ * @param view view which points into the data buffer afterwards
+ * @return true = valid socket with the given configuration
+ */
+inline bool ab_getSocketView(const char *data, size_t datalen, const ab_header &header, const ab_socket_config &sock_conf, ab_socket_view &view)
+{
+    uint16_t len = ab_getSocketLen(sock_conf);
+    if (header.dir != 1 || header.typ == 0 || (sock_conf.socket_id > 0 && header.typ != sock_conf.socket_id) ||
+        header.len != len || datalen < len + 14u)
+        return false;
+    view.frame = data;
+    view.config = sock_conf;
+    view.config.socket_id = header.typ;
+    view.sender = header.from;
+    view.bit_pos = 14;
+    view.int_pos = view.bit_pos + sock_conf.bitcount;
+    view.long_pos = view.int_pos + sock_conf.intcount * 2;
+    view.real_pos = view.long_pos + sock_conf.longcount * 4;
+    return true;
+}
+
+/**
+ * compile time socket layout with a fixed amount of bit, int, long and real tags
+ * all section offsets and the expected header length are constants, so encoding and decoding
+ * a socket with this layout compiles down to direct loads and stores without any checks per tag
+ * usage: typedef ab_socket_layout<1, 1, 1, 1> my_socket; my_socket::data values;
+ */
+template <uint8_t Bits, uint8_t Ints = 0, uint8_t Longs = 0, uint8_t Reals = 0>
+struct ab_socket_layout
+{
+    // frame positions of the tag sections
+    static constexpr uint16_t bit_pos = 14;
+    static constexpr uint16_t int_pos = bit_pos + Bits;
+    static constexpr uint16_t long_pos = int_pos + Ints * 2;
+    static constexpr uint16_t real_pos = long_pos + Longs * 4;
+    // expected header length and total frame length of a socket with this layout
+    static constexpr uint16_t header_len = Bits + Ints * 2 + Longs * 4 + Reals * 4 + 4;
+    static constexpr uint16_t frame_len = header_len + 14;
+    static_assert(Bits + Ints + Longs + Reals > 0, "ab_socket_layout without any tag");
+    static_assert(frame_len <= MAX_DATA_LEN, "ab_socket_layout does not fit into MAX_DATA_LEN");
+
+    // plain tag data of a socket with this layout
+    struct data
+    {
+        std::array<uint8_t, Bits> bitdata;
+        std::array<int16_t, Ints> intdata;
+        std::array<int32_t, Longs> longdata;
+        std::array<float_t, Reals> realdata;
+    };
+    // callback function pointer which receives the tag data and the sender NAD
+    typedef void (*callback)(const data &values, uint32_t sender);
+
+    /**
+     * socket configuration of this layout
+     * @param sock_id socket id no
+     * @return socket configuration
+     */
+    static ab_socket_config config(uint8_t sock_id)
+    {
+        ab_socket_config retval;
+        retval.socket_id = sock_id;
+        retval.bitcount = Bits;
+        retval.intcount = Ints;
+        retval.longcount = Longs;
+        retval.realcount = Reals;
+        return retval;
+    }
+
+    /**
+     * decode the tag data out of a frame, the frame has to be checked with ab_checkValidPacket() and header.len == header_len
+     * @param frame pointer to the frame buffer
+     * @param values tag data structure which receives the values
+     */
+    static void decode(const char *frame, data &values)
+    {
+        ab_decodeBits(frame + bit_pos, values.bitdata.data(), Bits);
+        ab_decodeInts(frame + int_pos, values.intdata.data(), Ints);
+        ab_decodeLongs(frame + long_pos, values.longdata.data(), Longs);
+        ab_decodeReals(frame + real_pos, values.realdata.data(), Reals);
+    }
+
+    /**
+     * encode the tag data into a frame, the header and crc have to be added with ab_setHeader() and ab_calcCRC()
+     * @param frame pointer to the frame buffer (at least frame_len bytes)
+     * @param values tag data structure with the values
+     */
+    static void encode(char *frame, const data &values)
+    {
+        ab_encodeBits(values.bitdata.data(), frame + bit_pos, Bits);
+        ab_encodeInts(values.intdata.data(), frame + int_pos, Ints);
+        ab_encodeLongs(values.longdata.data(), frame + long_pos, Longs);
+        ab_encodeReals(values.realdata.data(), frame + real_pos, Reals);
+    }
+};
+
+/**
+ * forward writer of a frame which accumulates the checksum while the frame is written
+ * the frame is written section by section in frame order, the checksum follows the write position
+ * in whole 16 byte blocks, so every byte is summed while it is still in the cache
+ */
+class ab_frame_writer
+{
+public:
+    /**
+     * constructor
+     * @param data pointer to data buffer
+     * @param len size of the data buffer
+     */
+    ab_frame_writer(char *data, size_t len) : m_data(data), m_len(len) {}
+    /**
+     * reserve the next section of the frame
+     * @param count size of the section in bytes
+     * @return pointer to the section which has to be filled by the caller (NULL = buffer too small)
+     */
+    char *section(size_t count)
+    {
+        sumBlocks();
+        if (m_overflow || m_pos + count > m_len)
+        {
+            m_overflow = true;
+            return NULL;
+        }
+        char *retval = m_data + m_pos;
+        m_pos += count;
+        return retval;
+    }
+    /**
+     * write an unsigned integer value (little endian)
+     * @param val value
+     */
+    void putUInt(uint16_t val)
+    {
+        char *p = section(2);
+        if (p != NULL)
+            ab_storeU16(p, val);
+    }
+    /**
+     * write an unsigned long value (little endian)
+     * @param val value
+     */
+    void putULong(uint32_t val)
+    {
+        char *p = section(4);
+        if (p != NULL)
+            ab_storeU32(p, val);
+    }
+    /**
+     * add the checksum of the frame as the last 2 bytes
+     * @return length of the finished frame (0 = buffer too small)
+     */
+    size_t finish()
+    {
+        ab_crcUpdate(m_crc, m_data + m_crcPos, m_pos - m_crcPos);
+        m_crcPos = m_pos;
+        uint16_t crc = ab_crcFinal(m_crc);
+        putUInt(crc);
+        return m_overflow ? 0 : m_pos;
+    }
+
+private:
+    char *m_data;
+    size_t m_len;
+    size_t m_pos = 0;         // write position
+    size_t m_crcPos = 0;      // bytes before this position are part of the checksum
+    bool m_overflow = false;  // a section did not fit into the buffer
+    ab_crc_state m_crc;
+    // add all complete blocks behind the checksum position to the checksum
+    void sumBlocks()
+    {
+        size_t count = (m_pos - m_crcPos) & ~(size_t)0x0F;
+        if (count > 0)
+        {
+            m_crc.crc += ab_calcCRCBlocks(reinterpret_cast<const uint8_t *>(m_data + m_crcPos), count >> 4);
+            m_crcPos += count;
+        }
+    }
+};
+
+/**
+ * write the frame header (AA 55, len, from, to, dir and typ), the ts_id of the header is written with putUInt() before finish()
+ * @param writer frame writer at the start of the frame
+ * @param header header of the frame
+ */
+inline void ab_writeHeader(ab_frame_writer &writer, const ab_header &header)
+{
+    char *p = writer.section(14);
+    if (p == NULL)
+        return;
+    p[0] = (char)0xAA;
+    p[1] = 0x55;
+    ab_storeU16(p + 2, header.len);
+    ab_storeU32(p + 4, header.from);
+    ab_storeU32(p + 8, header.to);
+    p[12] = (char)header.dir;
+    p[13] = (char)header.typ;
+}
+
+/**
+ * write the socket frame header (AA 55, len, from, to, dir and typ)
+ * @param writer frame writer at the start of the frame
+ * @param sock_id socket id no
+ * @param sender NAD of the sender
+ * @param len header length (tag data + 4)
+ * @param dest NAD of the receiver (0 = all)
+ */
+inline void ab_writeSocketHeader(ab_frame_writer &writer, uint8_t sock_id, uint32_t sender, uint16_t len, uint32_t dest = 0)
+{
+    ab_header header;
+    header.len = len;
+    header.from = sender;
+    header.to = dest;
+    header.dir = 1;
+    header.typ = sock_id;
+    ab_writeHeader(writer, header);
+}
+
+/**
+ * encode a complete socket frame (header, tag data, ts_id and crc) in one forward pass
+ * @param data pointer to data buffer
+ * @param len size of the data buffer
+ * @param socket socket with tag data (ab_socket or ab_fixed_socket)
+ * @param sender NAD of the sender
+ * @param ts_id transaction id of the frame
+ * @param dest NAD of the receiver (0 = all)
+ * @return length of the frame (0 = socket empty or buffer too small)
+ */
+template <class S>
+size_t ab_encodeSocket(char *data, size_t len, const S &socket, uint32_t sender, uint16_t ts_id = 0, uint32_t dest = 0)
+{
+    size_t bits = socket.bitdata.size();
+    size_t ints = socket.intdata.size();
+    size_t longs = socket.longdata.size();
+    size_t reals = socket.realdata.size();
+    size_t datalen = bits + ints * 2 + longs * 4 + reals * 4;
+    if (datalen == 0 || datalen + 18u > len || datalen + 18u > MAX_DATA_LEN)
+        return 0;
+    ab_frame_writer writer(data, len);
+    ab_writeSocketHeader(writer, socket.config.socket_id, sender, (uint16_t)(datalen + 4), dest);
+    ab_encodeBits(socket.bitdata.data(), writer.section(bits), bits);
+    ab_encodeInts(socket.intdata.data(), writer.section(ints * 2), ints);
+    ab_encodeLongs(socket.longdata.data(), writer.section(longs * 4), longs);
+    ab_encodeReals(socket.realdata.data(), writer.section(reals * 4), reals);
+    writer.putUInt(ts_id);
+    return writer.finish();
+}
+
+/**
+ * encode a complete socket frame of a compile time layout (header, tag data, ts_id and crc) in one forward pass
+ * usage: size_t len = ab_encodeSocket<my_socket>(buf, sizeof(buf), 3, values, nad);
+ * @param data pointer to data buffer
+ * @param len size of the data buffer
+ * @param sock_id socket id no
+ * @param values tag data of the layout
+ * @param sender NAD of the sender
+ * @param ts_id transaction id of the frame
+ * @param dest NAD of the receiver (0 = all)
+ * @return length of the frame (0 = buffer too small)
+ */
+template <class Layout>
+size_t ab_encodeSocket(char *data, size_t len, uint8_t sock_id, const typename Layout::data &values, uint32_t sender, uint16_t ts_id = 0, uint32_t dest = 0)
+{
+    if (len < Layout::frame_len)
+        return 0;
+    ab_frame_writer writer(data, len);
+    ab_writeSocketHeader(writer, sock_id, sender, Layout::header_len, dest);
+    // the layout encoder writes at the fixed frame positions of the tag sections
+    writer.section(Layout::header_len - 4);
+    Layout::encode(data, values);
+    writer.putUInt(ts_id);
+    return writer.finish();
+}
+
+// deadband of a real tag for change detection
+// a change is only reported if the value moved by more than absolute + relative * |last sent value|
+struct ab_deadband
+{
+    float_t absolute = 0.0;
+    float_t relative = 0.0;
+};
+
+/**
+ * compare the tag data of two encoded socket frames with the same configuration
+ * bit, int and long tags (and the sender) are compared exactly, real tags with the deadbands
+ * @param frame pointer to the new frame
+ * @param last pointer to the previously sent frame
+ * @param sock_conf structure with socket configuraton
+ * @param deadbands table with one deadband per real tag (NULL = every change is reported)
+ * @return true = the tag data changed
+ */
+inline bool ab_socketChanged(const char *frame, const char *last, const ab_socket_config &sock_conf, const ab_deadband *deadbands)
+{
+    uint16_t real_pos = 14 + sock_conf.bitcount + sock_conf.intcount * 2 + sock_conf.longcount * 4;
+    if (memcmp(frame, last, real_pos) != 0)
+        return true;
+    for (uint8_t i = 0; i < sock_conf.realcount; i++)
+    {
+        if (deadbands == NULL)
+        {
+            if (memcmp(frame + real_pos + i * 4, last + real_pos + i * 4, 4) != 0)
+                return true;
+            continue;
+        }
+        float_t val = ab_loadReal(frame + real_pos + i * 4);
+        float_t prev = ab_loadReal(last + real_pos + i * 4);
+        if (isnan(val) || isnan(prev))
+        {
+            if (isnan(val) != isnan(prev))
+                return true;
+            continue;
+        }
+        if (fabs(val - prev) > deadbands[i].absolute + deadbands[i].relative * fabs(prev))
+            return true;
+    }
+    return false;
 }
 
 /**
@@ -574,7 +1277,7 @@ void ab_setSocket(char *data, size_t datalen, ab_socket socket)
  * @param socket pointer to socket structure
  * @param value value which shall be added
  */
-void ab_addBitTag(ab_socket *socket, bool value)
+inline void ab_addBitTag(ab_socket *socket, bool value)
 {
     size_t pos = socket->bitdata.size() + 1;
     socket->bitdata.resize(pos, value);
@@ -586,7 +1289,7 @@ void ab_addBitTag(ab_socket *socket, bool value)
  * @param socket pointer to socket structure
  * @param value value which shall be added
  */
-void ab_addIntTag(ab_socket *socket, int16_t value)
+inline void ab_addIntTag(ab_socket *socket, int16_t value)
 {
     size_t pos = socket->intdata.size() + 1;
     socket->intdata.resize(pos, value);
@@ -598,7 +1301,7 @@ void ab_addIntTag(ab_socket *socket, int16_t value)
  * @param socket pointer to socket structure
  * @param value value which shall be added
  */
-void ab_addLongTag(ab_socket *socket, int32_t value)
+inline void ab_addLongTag(ab_socket *socket, int32_t value)
 {
     size_t pos = socket->longdata.size() + 1;
     socket->longdata.resize(pos, value);
@@ -610,7 +1313,7 @@ void ab_addLongTag(ab_socket *socket, int32_t value)
  * @param socket pointer to socket structure
  * @param value value which shall be added
  */
-void ab_addRealTag(ab_socket *socket, float_t value)
+inline void ab_addRealTag(ab_socket *socket, float_t value)
 {
     if(isnan(value))
         value = 0.0;
@@ -619,4 +1322,50 @@ void ab_addRealTag(ab_socket *socket, float_t value)
     socket->config.realcount = pos;
 }
 
+/**
+ * add a bool(ean) value to a socket with inline storage
+ * @param socket pointer to socket structure
+ * @param value value which shall be added
+ */
+inline void ab_addBitTag(ab_fixed_socket *socket, bool value)
+{
+    socket->bitdata.push_back(value);
+    socket->config.bitcount = socket->bitdata.size();
+}
+
+/**
+ * add a integer value to a socket with inline storage
+ * @param socket pointer to socket structure
+ * @param value value which shall be added
+ */
+inline void ab_addIntTag(ab_fixed_socket *socket, int16_t value)
+{
+    socket->intdata.push_back(value);
+    socket->config.intcount = socket->intdata.size();
+}
+
+/**
+ * add a long value to a socket with inline storage
+ * @param socket pointer to socket structure
+ * @param value value which shall be added
+ */
+inline void ab_addLongTag(ab_fixed_socket *socket, int32_t value)
+{
+    socket->longdata.push_back(value);
+    socket->config.longcount = socket->longdata.size();
+}
+
+/**
+ * add a real value to a socket with inline storage
+ * @param socket pointer to socket structure
+ * @param value value which shall be added
+ */
+inline void ab_addRealTag(ab_fixed_socket *socket, float_t value)
+{
+    if(isnan(value))
+        value = 0.0;
+    socket->realdata.push_back(value);
+    socket->config.realcount = socket->realdata.size();
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,160 @@
+/**
+ * abus_host.h
+ * Minimal subset of the Arduino core API used by this library, for builds on a (Linux) host without Arduino core.
+ * It is only included if ARDUINO is not defined.
+ */
+#ifndef _ABUS_HOST_H_
+#define _ABUS_HOST_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <cmath>
+#include <string>
+#include <algorithm>
+
+typedef uint8_t byte;
+using std::isnan;
+using std::max;
+using std::min;
+
+// flash strings are plain strings on the host
+#define F(string_literal) (string_literal)
+
+/**
+ * monotonic time since an arbitrary starting point
+ * @return time in microseconds
+ */
+inline unsigned long micros()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long)((uint64_t)ts.tv_sec * 1000000u + ts.tv_nsec / 1000);
+}
+
+/**
+ * monotonic time since an arbitrary starting point
+ * @return time in milliseconds
+ */
+inline unsigned long millis()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long)((uint64_t)ts.tv_sec * 1000u + ts.tv_nsec / 1000000);
+}
+
+/**
+ * sleep for the given time
+ * @param ms time in milliseconds
+ */
+inline void delay(unsigned long ms)
+{
+    struct timespec ts;
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (ms % 1000) * 1000000L;
+    nanosleep(&ts, NULL);
+}
+
+// small string class with the members of the Arduino String used by this library
+class String
+{
+public:
+    String(const char *str = "") : m_str(str ? str : "") {}
+    String(const std::string &str) : m_str(str) {}
+    const char *c_str() const { return m_str.c_str(); }
+    size_t length() const { return m_str.length(); }
+    void toCharArray(char *buf, size_t bufsize, size_t index = 0) const
+    {
+        if (bufsize == 0)
+            return;
+        size_t len = index < m_str.length() ? min(m_str.length() - index, bufsize - 1) : 0;
+        memcpy(buf, m_str.c_str() + index, len);
+        buf[len] = 0;
+    }
+    bool operator==(const String &other) const { return m_str == other.m_str; }
+
+private:
+    std::string m_str;
+};
+
+// ipv4 address, stored in network byte order like the Arduino IPAddress
+class IPAddress
+{
+public:
+    IPAddress() { memset(m_addr, 0, sizeof(m_addr)); }
+    IPAddress(uint8_t o1, uint8_t o2, uint8_t o3, uint8_t o4)
+    {
+        m_addr[0] = o1;
+        m_addr[1] = o2;
+        m_addr[2] = o3;
+        m_addr[3] = o4;
+    }
+    // address in network byte order (e.g. in_addr.s_addr)
+    IPAddress(uint32_t address) { memcpy(m_addr, &address, sizeof(m_addr)); }
+    operator uint32_t() const
+    {
+        uint32_t retval;
+        memcpy(&retval, m_addr, sizeof(retval));
+        return retval;
+    }
+    bool operator==(const IPAddress &other) const { return memcmp(m_addr, other.m_addr, sizeof(m_addr)) == 0; }
+    bool operator!=(const IPAddress &other) const { return !(*this == other); }
+    uint8_t operator[](int index) const { return m_addr[index]; }
+    uint8_t &operator[](int index) { return m_addr[index]; }
+    String toString() const
+    {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u.%u.%u.%u", m_addr[0], m_addr[1], m_addr[2], m_addr[3]);
+        return String(buf);
+    }
+    bool fromString(const char *address)
+    {
+        unsigned int o[4];
+        char tail;
+        if (sscanf(address, "%u.%u.%u.%u%c", &o[0], &o[1], &o[2], &o[3], &tail) != 4 || o[0] > 255 || o[1] > 255 || o[2] > 255 || o[3] > 255)
+            return false;
+        for (int i = 0; i < 4; i++)
+            m_addr[i] = (uint8_t)o[i];
+        return true;
+    }
+
+private:
+    uint8_t m_addr[4];
+};
+
+// output with the print functions of the Arduino Print class (used for Serial)
+class ab_host_print
+{
+public:
+    ab_host_print(FILE *stream = stdout) : m_stream(stream) {}
+    size_t print(const char *str) { return fputs(str, m_stream) >= 0 ? strlen(str) : 0; }
+    size_t print(const String &str) { return print(str.c_str()); }
+    size_t print(char c) { return fputc(c, m_stream) != EOF; }
+    size_t print(int val) { return fprintf(m_stream, "%d", val); }
+    size_t print(unsigned int val) { return fprintf(m_stream, "%u", val); }
+    size_t print(long val) { return fprintf(m_stream, "%ld", val); }
+    size_t print(unsigned long val) { return fprintf(m_stream, "%lu", val); }
+    size_t print(double val, int digits = 2) { return fprintf(m_stream, "%.*f", digits, val); }
+    template <typename T>
+    size_t println(const T &val) { return print(val) + println(); }
+    size_t println() { return print("\r\n"); }
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)))
+    {
+        va_list args;
+        va_start(args, format);
+        int retval = vfprintf(m_stream, format, args);
+        va_end(args);
+        return retval > 0 ? retval : 0;
+    }
+
+private:
+    FILE *m_stream;
+};
+
+static ab_host_print Serial;
+
+#endif
@@ -0,0 +1,137 @@
+/**
+ * abus_nad_cache.h
+ * Purpose: cache of the ip address and udp port of NADs, learned from the received frames
+
+ * @author Daniel Gangl
+ */
+#ifndef _ABUS_NAD_CACHE_H_
+#define _ABUS_NAD_CACHE_H_
+
+#include <abus_helper.h>
+
+// cache entry of a NAD
+struct ab_nad_entry
+{
+    uint32_t nad = 0;  // NAD (0 = free entry)
+    uint32_t ip = 0;   // ipv4 address in network byte order (IPAddress as uint32_t)
+    uint16_t port = 0; // udp port
+    uint32_t used = 0; // time stamp of the last use (cache clock)
+};
+
+/**
+ * fixed size NAD -> ip address / udp port cache without heap allocation
+ * the entries are organized in buckets of 4 entries (set associative hash),
+ * a full bucket replaces its least recently used entry
+ * @param N amount of entries (power of two, at least 4)
+ */
+template <uint16_t N>
+class ab_nad_cache
+{
+    static_assert(N >= 4 && (N & (N - 1)) == 0, "ab_nad_cache size must be a power of two and at least 4");
+
+public:
+    static constexpr uint16_t ways = 4; // entries per bucket
+    /**
+     * add or update the address of a NAD
+     * @param nad NAD of the sender
+     * @param ip ipv4 address of the sender (network byte order)
+     * @param port udp port of the sender
+     */
+    void learn(uint32_t nad, uint32_t ip, uint16_t port)
+    {
+        if (nad == 0 || ip == 0)
+            return;
+        ab_nad_entry *bucket = m_entries + bucketPos(nad);
+        ab_nad_entry *victim = &bucket[0];
+        for (uint16_t i = 0; i < ways; i++)
+        {
+            if (bucket[i].nad == nad)
+            {
+                victim = &bucket[i];
+                break;
+            }
+            // a free entry is used before the least recently used one
+            if (victim->nad != 0 && (bucket[i].nad == 0 || bucket[i].used < victim->used))
+                victim = &bucket[i];
+        }
+        victim->nad = nad;
+        victim->ip = ip;
+        victim->port = port;
+        victim->used = ++m_clock;
+    }
+    /**
+     * get the address of a NAD
+     * @param nad NAD to look for
+     * @param ip receives the ipv4 address (network byte order)
+     * @param port receives the udp port
+     * @return true = NAD known
+     */
+    bool lookup(uint32_t nad, uint32_t &ip, uint16_t &port)
+    {
+        ab_nad_entry *entry = find(nad);
+        if (entry == NULL)
+            return false;
+        ip = entry->ip;
+        port = entry->port;
+        entry->used = ++m_clock;
+        return true;
+    }
+    /**
+     * remove a NAD from the cache
+     * @param nad NAD to remove
+     * @return true = NAD was known
+     */
+    bool forget(uint32_t nad)
+    {
+        ab_nad_entry *entry = find(nad);
+        if (entry == NULL)
+            return false;
+        *entry = ab_nad_entry();
+        return true;
+    }
+    /**
+     * remove all entries
+     */
+    void clear()
+    {
+        for (uint16_t i = 0; i < N; i++)
+            m_entries[i] = ab_nad_entry();
+    }
+    /**
+     * @return amount of known NADs
+     */
+    uint16_t size() const
+    {
+        uint16_t retval = 0;
+        for (uint16_t i = 0; i < N; i++)
+            retval += m_entries[i].nad != 0;
+        return retval;
+    }
+
+private:
+    ab_nad_entry m_entries[N];
+    uint32_t m_clock = 0; // incremented on every use, the smallest stamp of a bucket is the least recently used entry
+    /**
+     * @param nad NAD
+     * @return position of the first entry of the bucket of the NAD
+     */
+    static uint16_t bucketPos(uint32_t nad)
+    {
+        // multiplicative hash, the NADs of one site often only differ in the low bits
+        return (uint16_t)(((nad * 0x9E3779B1u) >> 16) & (N / ways - 1)) * ways;
+    }
+    ab_nad_entry *find(uint32_t nad)
+    {
+        if (nad == 0)
+            return NULL;
+        ab_nad_entry *bucket = m_entries + bucketPos(nad);
+        for (uint16_t i = 0; i < ways; i++)
+        {
+            if (bucket[i].nad == nad)
+                return &bucket[i];
+        }
+        return NULL;
+    }
+};
+
+#endif
@@ -0,0 +1,216 @@
+/**
+ * abus_posix_transport.h
+ * Purpose: udp transport of abus_socket with POSIX sockets for Linux hosts (e.g. a gateway)
+
+ * @author Daniel Gangl
+ */
+#ifndef _ABUS_POSIX_TRANSPORT_H_
+#define _ABUS_POSIX_TRANSPORT_H_
+
+#include <abus_transport.h>
+
+#if !defined(ARDUINO)
+#include <errno.h>
+#include <fcntl.h>
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <netpacket/packet.h>
+#endif
+
+// size of the datagram receive buffer of the posix transport (largest frame, raise it together with the rxBufferSize of abus_socket)
+// a larger datagram is truncated, MSG_TRUNC still reports its real length, so abus_socket drops it by its length
+#ifndef ABSOCK_POSIX_RX_LEN
+#define ABSOCK_POSIX_RX_LEN MAX_DATA_LEN
+#endif
+
+/**
+ * udp transport with a non-blocking POSIX socket
+ * the socket file descriptor can be added to poll / epoll to wait for received datagrams
+ */
+class ab_posix_transport : public ab_transport
+{
+private:
+    int m_fd = -1;                        // udp socket
+    char m_ifname[IF_NAMESIZE];           // network interface name (empty = first broadcast interface)
+    char m_rxbuf[ABSOCK_POSIX_RX_LEN];    // current datagram
+    int m_rxlen = 0;                      // length of the current datagram in the receive buffer
+    int m_rxpos = 0;                      // read position in the current datagram
+    sockaddr_in m_remote;                 // sender of the current datagram
+    /**
+     * find the ipv4 address entry of the network interface
+     * @param list interface list of getifaddrs()
+     * @return matching entry (NULL = none)
+     */
+    const ifaddrs *findInterface(const ifaddrs *list) const
+    {
+        for (const ifaddrs *ifa = list; ifa != NULL; ifa = ifa->ifa_next)
+        {
+            if (ifa->ifa_addr == NULL || ifa->ifa_addr->sa_family != AF_INET || !(ifa->ifa_flags & IFF_UP))
+                continue;
+            if (m_ifname[0] != 0 ? strcmp(ifa->ifa_name, m_ifname) == 0 : !(ifa->ifa_flags & IFF_LOOPBACK) && (ifa->ifa_flags & IFF_BROADCAST))
+                return ifa;
+        }
+        return NULL;
+    }
+
+public:
+    /**
+     * constructor
+     * @param ifname network interface for the broadcast address and the NAD (NULL = first interface with broadcast)
+     */
+    ab_posix_transport(const char *ifname = NULL)
+    {
+        m_ifname[0] = 0;
+        if (ifname != NULL)
+        {
+            strncpy(m_ifname, ifname, sizeof(m_ifname) - 1);
+            m_ifname[sizeof(m_ifname) - 1] = 0;
+        }
+        memset(&m_remote, 0, sizeof(m_remote));
+    }
+    ~ab_posix_transport()
+    {
+        stop();
+    }
+    /**
+     * @return non-blocking udp socket file descriptor (-1 = not open)
+     */
+    int fd() const
+    {
+        return m_fd;
+    }
+    bool begin(uint16_t localUdpPort)
+    {
+        stop();
+        m_fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (m_fd < 0)
+            return false;
+        int on = 1;
+        setsockopt(m_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        setsockopt(m_fd, SOL_SOCKET, SO_BROADCAST, &on, sizeof(on));
+        fcntl(m_fd, F_SETFL, fcntl(m_fd, F_GETFL, 0) | O_NONBLOCK);
+        fcntl(m_fd, F_SETFD, FD_CLOEXEC);
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(localUdpPort);
+        if (bind(m_fd, (sockaddr *)&addr, sizeof(addr)) < 0)
+        {
+            ABUS_ERR_PRINTF("*AB: posix transport bind failed: %s\n", strerror(errno));
+            stop();
+            return false;
+        }
+        return true;
+    }
+    void stop()
+    {
+        if (m_fd >= 0)
+            close(m_fd);
+        m_fd = -1;
+        m_rxlen = 0;
+        m_rxpos = 0;
+    }
+    int parsePacket()
+    {
+        m_rxlen = 0;
+        m_rxpos = 0;
+        if (m_fd < 0)
+            return 0;
+        socklen_t addrlen = sizeof(m_remote);
+        // MSG_TRUNC returns the real length of datagrams which are larger than the receive buffer
+        ssize_t len = recvfrom(m_fd, m_rxbuf, sizeof(m_rxbuf), MSG_TRUNC, (sockaddr *)&m_remote, &addrlen);
+        if (len <= 0)
+            return 0;
+        m_rxlen = len < (ssize_t)sizeof(m_rxbuf) ? (int)len : (int)sizeof(m_rxbuf);
+        return (int)len;
+    }
+    void waitPacket(uint32_t timeoutMs)
+    {
+        if (m_fd < 0)
+        {
+            delay(timeoutMs);
+            return;
+        }
+        pollfd pfd;
+        pfd.fd = m_fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        poll(&pfd, 1, (int)timeoutMs);
+    }
+    int read(char *data, size_t len)
+    {
+        size_t avail = m_rxlen - m_rxpos;
+        if (len > avail)
+            len = avail;
+        if (len == 0)
+            return 0;
+        memcpy(data, m_rxbuf + m_rxpos, len);
+        m_rxpos += len;
+        return (int)len;
+    }
+    IPAddress remoteIP()
+    {
+        return IPAddress((uint32_t)m_remote.sin_addr.s_addr);
+    }
+    uint16_t remotePort()
+    {
+        return ntohs(m_remote.sin_port);
+    }
+    bool send(const IPAddress &ip, uint16_t port, const char *data, size_t datalen)
+    {
+        if (m_fd < 0)
+            return false;
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = (uint32_t)ip;
+        addr.sin_port = htons(port);
+        return sendto(m_fd, data, datalen, MSG_DONTWAIT, (sockaddr *)&addr, sizeof(addr)) == (ssize_t)datalen;
+    }
+    IPAddress broadcastIP()
+    {
+        IPAddress retval(255, 255, 255, 255);
+        ifaddrs *list = NULL;
+        if (getifaddrs(&list) != 0)
+            return retval;
+        const ifaddrs *ifa = findInterface(list);
+        if (ifa != NULL && (ifa->ifa_flags & IFF_BROADCAST) && ifa->ifa_broadaddr != NULL)
+            retval = IPAddress((uint32_t)((const sockaddr_in *)ifa->ifa_broadaddr)->sin_addr.s_addr);
+        freeifaddrs(list);
+        return retval;
+    }
+    uint32_t defaultNad()
+    {
+        uint32_t retval = 0;
+#if defined(__linux__)
+        ifaddrs *list = NULL;
+        if (getifaddrs(&list) != 0)
+            return 0;
+        const ifaddrs *ifa = findInterface(list);
+        if (ifa != NULL)
+        {
+            // the link layer entry of the same interface holds the mac address
+            for (const ifaddrs *ll = list; ll != NULL; ll = ll->ifa_next)
+            {
+                if (ll->ifa_addr == NULL || ll->ifa_addr->sa_family != AF_PACKET || strcmp(ll->ifa_name, ifa->ifa_name) != 0)
+                    continue;
+                const sockaddr_ll *mac = (const sockaddr_ll *)ll->ifa_addr;
+                if (mac->sll_halen >= 6)
+                    retval = (uint32_t)mac->sll_addr[2] << 24 | (uint32_t)mac->sll_addr[3] << 16 | (uint32_t)mac->sll_addr[4] << 8 | mac->sll_addr[5];
+                break;
+            }
+        }
+        freeifaddrs(list);
+#endif
+        return retval;
+    }
+};
+#endif
+
+#endif
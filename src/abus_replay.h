@@ -0,0 +1,91 @@
+/**
+ * abus_replay.h
+ * Purpose: feed a capture (see abus_capture.h) back through the receive path of abus_socket,
+ * as fast as possible for throughput tests or with the original timing
+
+ * @author Daniel Gangl
+ */
+#ifndef _ABUS_REPLAY_H_
+#define _ABUS_REPLAY_H_
+
+#include <abus_socket.h>
+
+// timing of a replay
+enum ab_replay_mode : uint8_t
+{
+    AB_REPLAY_FAST = 0,  // frames back to back
+    AB_REPLAY_TIMED = 1, // frames at the captured time distances
+};
+
+// result of a replay
+struct ab_replay_result
+{
+    uint32_t frames = 0;    // received frames passed to processFrame()
+    uint32_t bytes = 0;     // bytes of these frames
+    uint32_t skipped = 0;   // sent frames of the capture (not replayed)
+    uint32_t truncated = 0; // received frames which were not captured completely or do not fit into the receive buffer (not replayed)
+    uint32_t micros = 0;    // duration of the replay in us
+};
+
+/**
+ * replay the received frames of a capture, they pass the same checks and callbacks as datagrams from the transport
+ * the call returns when the capture is finished, the callbacks are called from the calling thread
+ * @param sock socket with the callbacks
+ * @param source captured frames
+ * @param mode AB_REPLAY_FAST or AB_REPLAY_TIMED
+ * @param maxFrames maximum amount of replayed frames (0 = all)
+ * @return counters and duration of the replay
+ */
+inline ab_replay_result ab_replay(abus_socket &sock, ab_capture_source &source, ab_replay_mode mode = AB_REPLAY_FAST, uint32_t maxFrames = 0)
+{
+    ab_replay_result retval;
+    ab_capture_record rec;
+    // frames up to the receive buffer size of the socket
+    std::vector<char> frame(sock.rxBufferSize());
+    uint32_t start = micros();
+    uint32_t last = start;
+    uint32_t lastTime = 0;
+    // the 32 bit time stamps wrap after 71 minutes, the distances are summed up in 64 bit
+    uint64_t elapsed = 0; // replay time since the start
+    uint64_t offset = 0;  // captured time of the frame since the first one
+    bool first = true;
+    while ((maxFrames == 0 || retval.frames < maxFrames) && source.next(rec, frame.data(), frame.size()))
+    {
+        if (rec.dir != AB_CAPTURE_RX)
+        {
+            retval.skipped++;
+            continue;
+        }
+        // the missing bytes of a truncated frame are unknown, it would only be counted as a bad crc
+        if (rec.caplen < rec.len)
+        {
+            retval.truncated++;
+            continue;
+        }
+        if (mode == AB_REPLAY_TIMED)
+        {
+            if (!first)
+                offset += (uint32_t)(rec.time - lastTime);
+            first = false;
+            lastTime = rec.time;
+            while (true)
+            {
+                uint32_t now = micros();
+                elapsed += (uint32_t)(now - last);
+                last = now;
+                if (elapsed >= offset)
+                    break;
+                // sleep for longer gaps, the rest is waited actively
+                if (offset - elapsed > 2000u)
+                    delay(1);
+            }
+        }
+        sock.processFrame(frame.data(), rec.len);
+        retval.frames++;
+        retval.bytes += rec.len;
+    }
+    retval.micros = micros() - start;
+    return retval;
+}
+
+#endif
@@ -0,0 +1,109 @@
+/**
+ * abus_ring.h
+ * Purpose: bounded lock free ring buffer for one producer and one consumer (e.g. main loop and a worker task)
+
+ * @author Daniel Gangl
+ */
+#ifndef _ABUS_RING_H_
+#define _ABUS_RING_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * single producer / single consumer ring buffer with inline storage (no heap allocation)
+ * the elements are written and read in place: the producer fills writeSlot() and publishes it with commit(),
+ * the consumer reads readSlot() and frees it with release()
+ * only atomic loads and stores are used, so it also works on targets without atomic read-modify-write instructions
+ * @param T element type
+ * @param N capacity (power of two)
+ */
+template <typename T, uint32_t N>
+class ab_spsc_ring
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "ab_spsc_ring capacity must be a power of two");
+
+public:
+    static constexpr uint32_t capacity() { return N; }
+    /**
+     * @return amount of elements in the ring (only a snapshot if the other side is active)
+     */
+    uint32_t size() const
+    {
+        return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+    }
+    bool empty() const { return size() == 0; }
+    bool full() const { return size() >= N; }
+    /**
+     * producer: next free element
+     * @return pointer to the element which has to be filled (NULL = ring full)
+     */
+    T *writeSlot()
+    {
+        uint32_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) >= N)
+            return NULL;
+        return &m_data[head & (N - 1)];
+    }
+    /**
+     * producer: publish the element returned by writeSlot()
+     */
+    void commit()
+    {
+        m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+    /**
+     * producer: copy an element into the ring
+     * @param value element
+     * @return true = added, false = ring full
+     */
+    bool push(const T &value)
+    {
+        T *slot = writeSlot();
+        if (slot == NULL)
+            return false;
+        *slot = value;
+        commit();
+        return true;
+    }
+    /**
+     * consumer: oldest element
+     * @return pointer to the element (NULL = ring empty)
+     */
+    T *readSlot()
+    {
+        uint32_t tail = m_tail.load(std::memory_order_relaxed);
+        if (m_head.load(std::memory_order_acquire) == tail)
+            return NULL;
+        return &m_data[tail & (N - 1)];
+    }
+    /**
+     * consumer: free the element returned by readSlot()
+     */
+    void release()
+    {
+        m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+    /**
+     * consumer: copy the oldest element out of the ring
+     * @param value receives the element
+     * @return true = element removed, false = ring empty
+     */
+    bool pop(T &value)
+    {
+        T *slot = readSlot();
+        if (slot == NULL)
+            return false;
+        value = *slot;
+        release();
+        return true;
+    }
+
+private:
+    T m_data[N];
+    std::atomic<uint32_t> m_head{0}; // amount of committed elements (written by the producer)
+    std::atomic<uint32_t> m_tail{0}; // amount of released elements (written by the consumer)
+};
+
+#endif
@@ -0,0 +1,541 @@
+/**
+ * abus_schema.h
+ * Purpose: socket definitions loaded from a CSV file (socket id, tag name, tag type) with precomputed frame
+ * offsets and a perfect hash index from the tag name to its socket, type and frame offset
+
+ * @author Daniel Gangl
+ */
+#ifndef _ABUS_SCHEMA_H_
+#define _ABUS_SCHEMA_H_
+
+#include <abus_helper.h>
+#include <ctype.h>
+#include <algorithm>
+#include <string>
+
+#if !defined(ARDUINO)
+#include <stdio.h>
+#include <strings.h>
+#endif
+
+// marker of a socket id without definition
+#define AB_SCHEMA_NONE 0xFF
+
+// type of a tag in the schema (same values as ab_var_type)
+enum ab_schema_type : uint8_t
+{
+    AB_SCHEMA_BIT = 0,  // 1 byte
+    AB_SCHEMA_INT = 1,  // 2 bytes, signed
+    AB_SCHEMA_LONG = 2, // 4 bytes, signed
+    AB_SCHEMA_REAL = 3, // 4 bytes, float
+};
+
+/**
+ * key of a tag name (64 bit FNV-1a), usable in constant expressions
+ * usage: static constexpr uint64_t TEMP = ab_schemaKey("boiler.temp");
+ * @param name 0 terminated tag name
+ * @param hash hash of the preceding characters
+ * @return key of the name
+ */
+constexpr uint64_t ab_schemaKey(const char *name, uint64_t hash = 14695981039346656037ull)
+{
+    return *name == 0 ? hash : ab_schemaKey(name + 1, (hash ^ (uint8_t)*name) * 1099511628211ull);
+}
+
+/**
+ * key of a tag name which is not 0 terminated
+ * @param name first character of the tag name
+ * @param len length of the tag name
+ * @return key of the name
+ */
+inline uint64_t ab_schemaKeyLen(const char *name, size_t len)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < len; i++)
+        hash = (hash ^ (uint8_t)name[i]) * 1099511628211ull;
+    return hash;
+}
+
+// tag of the schema
+struct ab_schema_tag
+{
+    uint64_t key = 0;   // ab_schemaKey() of the name
+    uint32_t name = 0;  // position of the name in the name pool (see ab_schema::name())
+    uint16_t offset = 0; // frame offset of the value
+    uint8_t sock_id = 0; // socket id
+    uint8_t type = 0;    // ab_schema_type
+    uint8_t index = 0;   // index of the tag within its type (e.g. for ab_socket_view::real())
+};
+
+/**
+ * socket definitions of a plant, loaded once at startup
+ * the file has one line per tag: socket id, tag name and type (BOOL / BIT, INT, LONG / DINT, REAL), separated by
+ * ';' or ','; empty lines, lines starting with '#' and a header line are skipped. The tags of a socket are
+ * ordered by type in the frame (bits, ints, longs, reals) and keep the file order within a type.
+ *   # socket;name;type
+ *   3;pump.run;BOOL
+ *   3;boiler.temp;REAL
+ * a name is found with one hash, one displacement and one key compare (no string compare); the lookup only
+ * compares the 64 bit key, load() rejects a file with two names of the same key
+ * usage:
+ *   ab_schema schema;
+ *   schema.loadFile("plant.csv");
+ *   abSock.setSocketCallbacks(schema.sockets(), schema.socketCount(), cbSocketReceived);
+ *   const ab_schema_tag *temp = schema.find("boiler.temp");
+ *   ... in the callback: float_t value; if (schema.getReal(view, *temp, value)) ...
+ */
+class ab_schema
+{
+public:
+    ab_schema()
+    {
+        clear();
+    }
+    /**
+     * load the socket definitions from a CSV text, previous definitions are replaced
+     * @param text CSV text
+     * @param len length of the text
+     * @return true = loaded, false = error (see errorLine(), the schema is empty afterwards)
+     */
+    bool load(const char *text, size_t len)
+    {
+        clear();
+        std::vector<ab_schema_entry> entries;
+        uint32_t line = 0;
+        bool first = true;
+        size_t pos = 0;
+        while (pos < len)
+        {
+            size_t end = pos;
+            while (end < len && text[end] != '\n')
+                end++;
+            line++;
+            ab_schema_field fields[3];
+            uint8_t count = split(text + pos, end - pos, fields);
+            pos = end + 1;
+            if (count == 0 || (fields[0].len > 0 && fields[0].text[0] == '#'))
+                continue;
+            ab_schema_entry entry;
+            entry.line = line;
+            // the first line may name the columns
+            if (first && (fields[0].len == 0 || !isdigit((uint8_t)fields[0].text[0])))
+            {
+                first = false;
+                continue;
+            }
+            first = false;
+            if (count < 3 || !parseId(fields[0], entry.sock_id) || fields[1].len == 0 || !parseType(fields[2], entry.type))
+                return fail(line);
+            entry.name = fields[1];
+            entries.push_back(entry);
+        }
+        return build(entries);
+    }
+#if !defined(ARDUINO)
+    /**
+     * load the socket definitions from a CSV file, previous definitions are replaced
+     * @param path path of the file
+     * @return true = loaded, false = error (see errorLine(), 0 = file not readable)
+     */
+    bool loadFile(const char *path)
+    {
+        FILE *file = fopen(path, "rb");
+        if (file == NULL)
+            return fail(0);
+        std::string text;
+        char buf[4096];
+        size_t len;
+        while ((len = fread(buf, 1, sizeof(buf), file)) > 0)
+            text.append(buf, len);
+        fclose(file);
+        return load(text.data(), text.size());
+    }
+#endif
+    /**
+     * remove all definitions
+     */
+    void clear()
+    {
+        m_sockets.clear();
+        m_tags.clear();
+        m_names.clear();
+        m_slots.clear();
+        m_seeds.clear();
+        memset(m_sockIndex, AB_SCHEMA_NONE, sizeof(m_sockIndex));
+        m_errorLine = 0;
+    }
+    /**
+     * find a tag by its name
+     * @param name 0 terminated tag name
+     * @return tag (NULL = unknown name)
+     */
+    const ab_schema_tag *find(const char *name) const
+    {
+        return find(ab_schemaKey(name));
+    }
+    /**
+     * find a tag by the key of its name
+     * @param key ab_schemaKey() of the name
+     * @return tag (NULL = unknown name)
+     */
+    const ab_schema_tag *find(uint64_t key) const
+    {
+        if (m_seeds.empty())
+            return NULL;
+        uint16_t entry = m_slots[slot(key, m_seeds[bucket(key)])];
+        if (entry == 0 || m_tags[entry - 1].key != key)
+            return NULL;
+        return &m_tags[entry - 1];
+    }
+    /**
+     * @param tag tag of this schema
+     * @return name of the tag
+     */
+    const char *name(const ab_schema_tag &tag) const
+    {
+        return m_names.c_str() + tag.name;
+    }
+    /**
+     * @return socket configurations ordered by socket id, e.g. for abus_socket::setSocketCallbacks()
+     */
+    const ab_socket_config *sockets() const
+    {
+        return m_sockets.data();
+    }
+    /**
+     * @return amount of sockets
+     */
+    uint8_t socketCount() const
+    {
+        return (uint8_t)m_sockets.size();
+    }
+    /**
+     * @param sock_id socket id
+     * @return socket configuration (NULL = socket id not defined)
+     */
+    const ab_socket_config *socket(uint8_t sock_id) const
+    {
+        return m_sockIndex[sock_id] == AB_SCHEMA_NONE ? NULL : &m_sockets[m_sockIndex[sock_id]];
+    }
+    /**
+     * @param sock_id socket id
+     * @return header.len a received frame of the socket has (0 = socket id not defined)
+     */
+    uint16_t socketLen(uint8_t sock_id) const
+    {
+        const ab_socket_config *config = socket(sock_id);
+        return config == NULL ? 0 : ab_getSocketLen(*config);
+    }
+    /**
+     * @return tags ordered by socket id and frame offset
+     */
+    const ab_schema_tag *tags() const
+    {
+        return m_tags.data();
+    }
+    /**
+     * @return amount of tags
+     */
+    uint16_t tagCount() const
+    {
+        return (uint16_t)m_tags.size();
+    }
+    /**
+     * @return line of the last load error (0 = no line: file not readable or no perfect hash found)
+     */
+    uint32_t errorLine() const
+    {
+        return m_errorLine;
+    }
+    /**
+     * read a bit tag of a received socket
+     * @param view view of the received socket
+     * @param tag bit tag of this schema
+     * @param value receives the value
+     * @return false = the view is no frame of the socket of the tag or the tag is no bit
+     */
+    bool getBit(const ab_socket_view &view, const ab_schema_tag &tag, bool &value) const
+    {
+        if (!matches(view, tag, AB_SCHEMA_BIT))
+            return false;
+        value = view.frame[tag.offset] != 0;
+        return true;
+    }
+    /**
+     * read an int tag of a received socket
+     * @param view view of the received socket
+     * @param tag int tag of this schema
+     * @param value receives the value
+     * @return false = the view is no frame of the socket of the tag or the tag is no int
+     */
+    bool getInt(const ab_socket_view &view, const ab_schema_tag &tag, int16_t &value) const
+    {
+        if (!matches(view, tag, AB_SCHEMA_INT))
+            return false;
+        value = ab_loadI16(view.frame + tag.offset);
+        return true;
+    }
+    /**
+     * read a long tag of a received socket
+     * @param view view of the received socket
+     * @param tag long tag of this schema
+     * @param value receives the value
+     * @return false = the view is no frame of the socket of the tag or the tag is no long
+     */
+    bool getLong(const ab_socket_view &view, const ab_schema_tag &tag, int32_t &value) const
+    {
+        if (!matches(view, tag, AB_SCHEMA_LONG))
+            return false;
+        value = ab_loadI32(view.frame + tag.offset);
+        return true;
+    }
+    /**
+     * read a real tag of a received socket
+     * @param view view of the received socket
+     * @param tag real tag of this schema
+     * @param value receives the value
+     * @return false = the view is no frame of the socket of the tag or the tag is no real
+     */
+    bool getReal(const ab_socket_view &view, const ab_schema_tag &tag, float_t &value) const
+    {
+        if (!matches(view, tag, AB_SCHEMA_REAL))
+            return false;
+        value = ab_loadReal(view.frame + tag.offset);
+        return true;
+    }
+
+private:
+    // field of a CSV line
+    struct ab_schema_field
+    {
+        const char *text = NULL;
+        size_t len = 0;
+    };
+    // parsed CSV line
+    struct ab_schema_entry
+    {
+        ab_schema_field name;
+        uint32_t line = 0;
+        uint8_t sock_id = 0;
+        uint8_t type = 0;
+    };
+
+    std::vector<ab_socket_config> m_sockets; // socket layouts ordered by socket id
+    std::vector<ab_schema_tag> m_tags;       // tags ordered by socket id and frame offset
+    std::string m_names;                     // 0 terminated names of all tags
+    std::vector<uint16_t> m_slots;           // perfect hash table: tag index + 1 (0 = free)
+    std::vector<uint16_t> m_seeds;           // displacement per bucket of the perfect hash
+    uint8_t m_sockIndex[256];                // socket id -> index in m_sockets
+    uint32_t m_errorLine;
+
+    bool fail(uint32_t line)
+    {
+        clear();
+        m_errorLine = line;
+        return false;
+    }
+    /**
+     * split a line into trimmed fields, surrounding quotes are removed
+     * @return amount of fields (0 = empty line, at most 3)
+     */
+    static uint8_t split(const char *text, size_t len, ab_schema_field *fields)
+    {
+        uint8_t count = 0;
+        size_t pos = 0;
+        while (count < 3)
+        {
+            size_t end = pos;
+            while (end < len && text[end] != ';' && text[end] != ',')
+                end++;
+            size_t first = pos;
+            size_t last = end;
+            while (first < last && isspace((uint8_t)text[first]))
+                first++;
+            while (last > first && isspace((uint8_t)text[last - 1]))
+                last--;
+            if (last - first >= 2 && text[first] == '"' && text[last - 1] == '"')
+            {
+                first++;
+                last--;
+            }
+            fields[count].text = text + first;
+            fields[count++].len = last - first;
+            if (end >= len)
+                break;
+            pos = end + 1;
+        }
+        return count == 1 && fields[0].len == 0 ? 0 : count;
+    }
+    static bool parseId(const ab_schema_field &field, uint8_t &sock_id)
+    {
+        uint32_t val = 0;
+        if (field.len == 0 || field.len > 3)
+            return false;
+        for (size_t i = 0; i < field.len; i++)
+        {
+            if (field.text[i] < '0' || field.text[i] > '9')
+                return false;
+            val = val * 10 + (field.text[i] - '0');
+        }
+        if (val == 0 || val > 255)
+            return false;
+        sock_id = (uint8_t)val;
+        return true;
+    }
+    static bool parseType(const ab_schema_field &field, uint8_t &type)
+    {
+        static const struct
+        {
+            const char *name;
+            uint8_t type;
+        } types[] = {{"BOOL", AB_SCHEMA_BIT}, {"BIT", AB_SCHEMA_BIT}, {"INT", AB_SCHEMA_INT}, {"LONG", AB_SCHEMA_LONG},
+                     {"DINT", AB_SCHEMA_LONG}, {"REAL", AB_SCHEMA_REAL}};
+        for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++)
+        {
+            if (strlen(types[i].name) == field.len && strncasecmp(types[i].name, field.text, field.len) == 0)
+            {
+                type = types[i].type;
+                return true;
+            }
+        }
+        return false;
+    }
+    // compute the socket layouts and frame offsets and create the name index
+    bool build(std::vector<ab_schema_entry> &entries)
+    {
+        // the name index stores the tag index + 1 in 16 bits, the first entry beyond the limit is reported
+        if (entries.size() >= 0xFFFF)
+            return fail(entries[0xFFFE].line);
+        // frame order: socket id, type, file order
+        std::stable_sort(entries.begin(), entries.end(), [](const ab_schema_entry &a, const ab_schema_entry &b) {
+            return a.sock_id != b.sock_id ? a.sock_id < b.sock_id : a.type < b.type;
+        });
+        uint16_t counts[4] = {0, 0, 0, 0};
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            const ab_schema_entry &entry = entries[i];
+            if (i == 0 || entries[i - 1].sock_id != entry.sock_id)
+            {
+                memset(counts, 0, sizeof(counts));
+                m_sockIndex[entry.sock_id] = (uint8_t)m_sockets.size();
+                m_sockets.push_back(ab_socket_config());
+                m_sockets.back().socket_id = entry.sock_id;
+            }
+            ab_socket_config &config = m_sockets.back();
+            uint16_t datalen = ab_getSocketLen(config) - 4 + typeSize(entry.type);
+            if (counts[entry.type] == 255 || datalen > AB_MAX_SOCKET_DATA)
+                return fail(entry.line);
+            ab_schema_tag tag;
+            tag.key = ab_schemaKeyLen(entry.name.text, entry.name.len);
+            tag.name = (uint32_t)m_names.size();
+            tag.sock_id = entry.sock_id;
+            tag.type = entry.type;
+            tag.index = (uint8_t)counts[entry.type]++;
+            m_names.append(entry.name.text, entry.name.len);
+            m_names += '\0';
+            m_tags.push_back(tag);
+            config.bitcount = (uint8_t)counts[AB_SCHEMA_BIT];
+            config.intcount = (uint8_t)counts[AB_SCHEMA_INT];
+            config.longcount = (uint8_t)counts[AB_SCHEMA_LONG];
+            config.realcount = (uint8_t)counts[AB_SCHEMA_REAL];
+        }
+        // the offsets are known when all tags of a socket are counted
+        for (size_t i = 0; i < m_tags.size(); i++)
+        {
+            ab_schema_tag &tag = m_tags[i];
+            const ab_socket_config &config = m_sockets[m_sockIndex[tag.sock_id]];
+            uint16_t pos = 14;
+            if (tag.type > AB_SCHEMA_BIT)
+                pos += config.bitcount;
+            if (tag.type > AB_SCHEMA_INT)
+                pos += config.intcount * 2;
+            if (tag.type > AB_SCHEMA_LONG)
+                pos += config.longcount * 4;
+            tag.offset = pos + tag.index * typeSize(tag.type);
+        }
+        // two equal keys would make a name unreachable (same name twice or a key collision)
+        std::vector<uint16_t> order(m_tags.size());
+        for (size_t i = 0; i < order.size(); i++)
+            order[i] = (uint16_t)i;
+        std::sort(order.begin(), order.end(), [this](uint16_t a, uint16_t b) { return m_tags[a].key < m_tags[b].key; });
+        for (size_t i = 1; i < order.size(); i++)
+        {
+            if (m_tags[order[i]].key == m_tags[order[i - 1]].key)
+                return fail(entries[max(order[i], order[i - 1])].line);
+        }
+        return buildIndex() || fail(0);
+    }
+    /**
+     * perfect hash (hash and displace): the keys are grouped into buckets, every bucket gets the first
+     * displacement which puts all its keys into free slots, the largest buckets are placed first
+     * @return true = index created
+     */
+    bool buildIndex()
+    {
+        if (m_tags.empty())
+            return true;
+        size_t count = m_tags.size();
+        m_slots.assign(count + count / 4 + 1, 0);
+        m_seeds.assign(count / 4 + 1, 0);
+        std::vector<std::vector<uint16_t>> buckets(m_seeds.size());
+        for (size_t i = 0; i < count; i++)
+            buckets[bucket(m_tags[i].key)].push_back((uint16_t)i);
+        std::vector<uint16_t> order(buckets.size());
+        for (size_t i = 0; i < order.size(); i++)
+            order[i] = (uint16_t)i;
+        std::stable_sort(order.begin(), order.end(), [&buckets](uint16_t a, uint16_t b) { return buckets[a].size() > buckets[b].size(); });
+        std::vector<uint32_t> slots;
+        for (size_t i = 0; i < order.size() && !buckets[order[i]].empty(); i++)
+        {
+            const std::vector<uint16_t> &keys = buckets[order[i]];
+            uint32_t seed = 0;
+            for (; seed <= 0xFFFF; seed++)
+            {
+                slots.clear();
+                for (size_t k = 0; k < keys.size(); k++)
+                {
+                    uint32_t pos = slot(m_tags[keys[k]].key, (uint16_t)seed);
+                    if (m_slots[pos] != 0 || std::find(slots.begin(), slots.end(), pos) != slots.end())
+                        break;
+                    slots.push_back(pos);
+                }
+                if (slots.size() == keys.size())
+                    break;
+            }
+            if (seed > 0xFFFF)
+                return false;
+            m_seeds[order[i]] = (uint16_t)seed;
+            for (size_t k = 0; k < keys.size(); k++)
+                m_slots[slots[k]] = keys[k] + 1;
+        }
+        return true;
+    }
+    uint32_t bucket(uint64_t key) const
+    {
+        return (uint32_t)(key >> 32) % (uint32_t)m_seeds.size();
+    }
+    uint32_t slot(uint64_t key, uint16_t seed) const
+    {
+        // splitmix64 finalizer of the displaced key
+        uint64_t val = key + (seed + 1) * 0x9E3779B97F4A7C15ull;
+        val = (val ^ (val >> 30)) * 0xBF58476D1CE4E5B9ull;
+        val = (val ^ (val >> 27)) * 0x94D049BB133111EBull;
+        return (uint32_t)((val ^ (val >> 31)) % m_slots.size());
+    }
+    static uint8_t typeSize(uint8_t type)
+    {
+        return type == AB_SCHEMA_BIT ? 1 : type == AB_SCHEMA_INT ? 2 : 4;
+    }
+    bool matches(const ab_socket_view &view, const ab_schema_tag &tag, uint8_t type) const
+    {
+        if (tag.type != type || view.frame == NULL || view.config.socket_id != tag.sock_id ||
+            m_sockIndex[tag.sock_id] == AB_SCHEMA_NONE)
+            return false;
+        // the view has to be decoded with the layout of the schema
+        const ab_socket_config &config = m_sockets[m_sockIndex[tag.sock_id]];
+        return view.config.bitcount == config.bitcount && view.config.intcount == config.intcount &&
+               view.config.longcount == config.longcount && view.config.realcount == config.realcount;
+    }
+};
+
+#endif
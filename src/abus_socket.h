@@ -8,16 +8,69 @@
 #ifndef _ABUS_SOCKET_H_
 #define _ABUS_SOCKET_H_
 
+#ifndef MAX_DATA_LEN
 #define MAX_DATA_LEN 255
+#endif
 
+#ifndef ABSOCK_MAX_SOCKETS
 #define ABSOCK_MAX_SOCKETS 32
+#endif
+// end marker of a callback chain in the dispatch table
+#define ABSOCK_CB_NONE 0xFF
+// amount of frames in the transmit queue (power of two, 0 = sendSocket() sends the frame immediately)
+#ifndef ABSOCK_TX_QUEUE_LEN
+#define ABSOCK_TX_QUEUE_LEN 8
+#endif
+// amount of checked frames between the receive task and loop() (power of two, ESP32 / Linux only, 0 = no receive task)
+#ifndef ABSOCK_RX_QUEUE_LEN
+#define ABSOCK_RX_QUEUE_LEN 16
+#endif
+// amount of socket ids with a minimum send interval (see setSendInterval(), 0 = no coalescing)
+// every slot holds a waiting frame (MAX_DATA_LEN bytes)
+#ifndef ABSOCK_TX_SLOTS
+#define ABSOCK_TX_SLOTS 2
+#endif
+// amount of NADs in the address cache for unicast frames (power of two, 0 = all frames are broadcast)
+#ifndef ABSOCK_NAD_CACHE_LEN
+#define ABSOCK_NAD_CACHE_LEN 16
+#endif
+// 1 = count dispatch hits and misses per registered socket id (8 bytes per callback entry), 0 = only the totals
+#ifndef ABSOCK_ID_STATS
+#define ABSOCK_ID_STATS 1
+#endif
+// amount of receivers of the frames which are no sockets: setFrameHook() and addFrameHook() (e.g. abus_client)
+#ifndef ABSOCK_MAX_FRAME_HOOKS
+#define ABSOCK_MAX_FRAME_HOOKS 3
+#endif
+// amount of outbound sockets with change detection (see addPublisher(), 0 = none)
+// every publisher keeps its last sent frame (MAX_DATA_LEN bytes)
+#ifndef ABSOCK_MAX_PUBLISHERS
+#define ABSOCK_MAX_PUBLISHERS 2
+#endif
 
-// Uncomment/comment to turn on/off debug output messages.
+// Uncomment/comment to turn on/off debug output messages (or define ABSOCK_NO_DEBUG before the include).
+// The compiled in messages are only printed if the log level of the instance allows it (see setLogLevel()).
+#ifndef ABSOCK_NO_DEBUG
 #define ABSOCK_DEBUG
-// Uncomment/comment to turn on/off error output messages.
+#endif
+// Uncomment/comment to turn on/off error output messages (or define ABSOCK_NO_ERROR before the include).
+#ifndef ABSOCK_NO_ERROR
 #define ABSOCK_ERROR
+#endif
 
 //#define ABSOCK_PARSE_NON_SOCKET
+// Uncomment to print a hex dump of every sent frame (slow, only for debugging the frame content).
+//#define ABSOCK_DEBUG_FRAMES
+
+// log level of new instances (AB_LOG_NONE, AB_LOG_ERROR or AB_LOG_DEBUG)
+// compiled in debug messages are printed unless setLogLevel() lowers the level
+#ifndef ABSOCK_LOG_LEVEL
+#ifdef ABSOCK_DEBUG
+#define ABSOCK_LOG_LEVEL AB_LOG_DEBUG
+#else
+#define ABSOCK_LOG_LEVEL AB_LOG_ERROR
+#endif
+#endif
 
 // Set where debug messages will be printed.
 #define ABSOCK_DBG_PRINTER Serial
@@ -25,17 +78,20 @@
 
 // Define actual debug output functions when necessary.
 #ifdef ABSOCK_DEBUG
-#define ABSOCK_DBG_PRINT(...)                  \
-    {                                          \
-        ABSOCK_DBG_PRINTER.print(__VA_ARGS__); \
+#define ABSOCK_DBG_PRINT(...)                      \
+    {                                              \
+        if (logLevel() >= AB_LOG_DEBUG)            \
+            ABSOCK_DBG_PRINTER.print(__VA_ARGS__); \
     }
-#define ABSOCK_DBG_PRINTF(...)                  \
-    {                                           \
-        ABSOCK_DBG_PRINTER.printf(__VA_ARGS__); \
+#define ABSOCK_DBG_PRINTF(...)                      \
+    {                                               \
+        if (logLevel() >= AB_LOG_DEBUG)             \
+            ABSOCK_DBG_PRINTER.printf(__VA_ARGS__); \
     }
-#define ABSOCK_DBG_PRINTLN(...)                  \
-    {                                            \
-        ABSOCK_DBG_PRINTER.println(__VA_ARGS__); \
+#define ABSOCK_DBG_PRINTLN(...)                      \
+    {                                                \
+        if (logLevel() >= AB_LOG_DEBUG)              \
+            ABSOCK_DBG_PRINTER.println(__VA_ARGS__); \
     }
 #else
 #define ABSOCK_DBG_PRINT(...) \
@@ -50,17 +106,20 @@
 #endif
 
 #ifdef ABSOCK_ERROR
-#define ABSOCK_ERR_PRINT(...)                  \
-    {                                          \
-        ABSOCK_DBG_PRINTER.print(__VA_ARGS__); \
+#define ABSOCK_ERR_PRINT(...)                      \
+    {                                              \
+        if (logLevel() >= AB_LOG_ERROR)            \
+            ABSOCK_DBG_PRINTER.print(__VA_ARGS__); \
     }
-#define ABSOCK_ERR_PRINTF(...)                  \
-    {                                           \
-        ABSOCK_DBG_PRINTER.printf(__VA_ARGS__); \
+#define ABSOCK_ERR_PRINTF(...)                      \
+    {                                               \
+        if (logLevel() >= AB_LOG_ERROR)             \
+            ABSOCK_DBG_PRINTER.printf(__VA_ARGS__); \
     }
-#define ABSOCK_ERR_PRINTLN(...)                  \
-    {                                            \
-        ABSOCK_DBG_PRINTER.println(__VA_ARGS__); \
+#define ABSOCK_ERR_PRINTLN(...)                      \
+    {                                                \
+        if (logLevel() >= AB_LOG_ERROR)              \
+            ABSOCK_DBG_PRINTER.println(__VA_ARGS__); \
     }
 #else
 #define ABSOCK_ERR_PRINT(...) \
@@ -74,23 +133,518 @@
     }
 #endif
 
+#include <new>
 #include <abus_helper.h>
-#include <WiFiUdp.h>
+#include <abus_transport.h>
+#include <abus_ring.h>
+#include <abus_task.h>
+#include <abus_nad_cache.h>
+#include <abus_trace.h>
+#include <abus_capture.h>
+#include <abus_tag_mirror.h>
+#include <abus_dedup.h>
+#include <abus_schema.h>
+#if !defined(ARDUINO)
+#include <abus_posix_transport.h>
+#endif
+#if defined(AB_TASK_SUPPORTED) && ABSOCK_RX_QUEUE_LEN > 0
+#define ABSOCK_RX_TASK 1
+#endif
 
 //Function pointer that returns a received socket
 typedef void (*SubscribeCallbackAbSocket)(ab_socket);
+//Function pointer that returns a received socket with inline storage by reference (no heap allocation, no copy)
+typedef void (*SubscribeCallbackAbFixedSocket)(const ab_fixed_socket &);
+//Function pointer that returns a lazy view on the received socket (tags are decoded on access)
+typedef void (*SubscribeCallbackAbSocketView)(const ab_socket_view &);
+
+// kind of a socket callback
+enum ab_callback_kind : uint8_t
+{
+    AB_CB_SOCKET = 0, // SubscribeCallbackAbSocket
+    AB_CB_FIXED = 1,  // SubscribeCallbackAbFixedSocket
+    AB_CB_TYPED = 2,  // ab_socket_layout<>::callback, called through a ab_typed_thunk
+    AB_CB_VIEW = 3,   // SubscribeCallbackAbSocketView
+    AB_CB_REMOVED = 4 // removed by a callback during the dispatch, unlinked after the dispatch pass
+};
+
+//Function pointer which receives all valid frames which are no socket frames (e.g. replies to variable requests, see abus_client)
+typedef void (*ab_frame_hook)(void *ctx, const char *frame, size_t len, const ab_header &header);
+//Function pointer which decodes a socket with a compile time layout and calls the typed callback
+typedef void (*ab_typed_thunk)(const char *frame, const ab_header &header, void (*cbFunction)());
+
+// storage of a socket callback function pointer, the used member is selected by ab_callback_kind
+union ab_socket_callback
+{
+    SubscribeCallbackAbSocket socket;
+    SubscribeCallbackAbFixedSocket fixed;
+    SubscribeCallbackAbSocketView view;
+    void (*typed)();
+};
+
+/**
+ * decode a socket with the given compile time layout and forward it to the typed callback
+ * @param frame pointer to the checked frame buffer
+ * @param header header of the frame
+ * @param cbFunction typed callback (Layout::callback)
+ */
+template <class Layout>
+void ab_typedSocketThunk(const char *frame, const ab_header &header, void (*cbFunction)())
+{
+    typename Layout::data values;
+    Layout::decode(frame, values);
+    reinterpret_cast<typename Layout::callback>(cbFunction)(values, header.from);
+}
+
+// result of a receive loop run
+struct ab_loop_result
+{
+    uint16_t handled = 0; // amount of datagrams handled in this call
+    uint16_t pending = 0; // amount of datagrams which are still waiting (the transport can only tell if there is at least one)
+};
+
+// level of the printed messages of an instance
+enum ab_log_level : uint8_t
+{
+    AB_LOG_NONE = 0,  // nothing is printed
+    AB_LOG_ERROR = 1, // errors
+    AB_LOG_DEBUG = 2, // errors and a line per frame (only if ABSOCK_DEBUG is compiled in)
+};
+
+// result of a send request
+enum ab_send_result : uint8_t
+{
+    AB_SEND_OK = 0,           // frame handed to the transport
+    AB_SEND_QUEUED = 1,       // frame queued, it is sent by loop() / flush() or the transmit task
+    AB_SEND_QUEUE_FULL = 2,   // transmit queue full, the frame was dropped
+    AB_SEND_INVALID = 3,      // socket id, sender or socket data invalid
+    AB_SEND_FAILED = 4,       // the transport did not accept the frame
+    AB_SEND_RATE_LIMITED = 5, // global packet rate exceeded, the frame was dropped (only without transmit queue)
+    AB_SEND_UNCHANGED = 6,    // publish(): no change since the last sent frame and heartbeat not due, nothing sent
+};
+
+// encoded frame in the transmit queue
+struct ab_tx_frame
+{
+    uint16_t len = 0;
+    uint16_t port = 0; // udp port of a unicast frame
+    uint32_t ip = 0;   // ip address of a unicast frame (network byte order, 0 = broadcast)
+    char data[MAX_DATA_LEN];
+};
+
+// checked frame which the receive task hands over to loop()
+struct ab_rx_frame
+{
+    uint16_t len = 0;
+    uint16_t port = 0;   // udp port of the sender
+    uint32_t ip = 0;     // ip address of the sender (network byte order)
+    char *data = NULL;   // frame in the receive buffer of the queue entry
+};
+
+// coalescing slot of a socket id with a minimum send interval, only the newest frame waits in it
+struct ab_tx_slot
+{
+    uint8_t id = 0;          // socket id (0 = free slot)
+    bool pending = false;    // a frame is waiting for the end of the interval
+    uint16_t interval = 0;   // minimum send interval in ms
+    uint32_t last = 0;       // time of the last hand over to the transmit queue in ms
+    ab_tx_frame frame;       // newest frame of the socket id
+};
+
+// outbound socket which is only sent if its tag data changed or the heartbeat interval is over
+struct ab_publisher
+{
+    ab_socket_config config;              // socket configuration (socket_id 0 = free entry)
+    uint16_t heartbeat = 0;               // interval in ms after which the last frame is sent again (0 = no heartbeat)
+    const ab_deadband *deadbands = NULL;  // deadband per real tag, owned by the caller (NULL = every change is sent)
+    uint32_t last = 0;                    // time of the last sent frame in ms
+    bool valid = false;                   // frame holds the last sent frame
+    ab_tx_frame frame;                    // last sent frame
+};
+
+// counters of the transmit path
+// sent, failed and unicast are written by the sending thread (the transmit task while it runs), all others by the caller of send*() / loop()
+struct ab_tx_stats
+{
+    uint32_t queued = 0;    // frames added to the transmit queue
+    uint32_t sent = 0;      // frames handed to the transport
+    uint32_t failed = 0;    // frames the transport did not accept
+    uint32_t dropped = 0;   // frames dropped because the transmit queue was full or the rate was exceeded
+    uint32_t coalesced = 0; // waiting frames replaced by a newer frame of the same socket id
+    uint32_t unchanged = 0; // publish() calls without a change (nothing sent)
+    uint32_t unicast = 0;   // frames sent to the learned address of the destination NAD
+    uint16_t queue_max = 0; // highest amount of frames in the transmit queue
+};
+
+// counters of the receive path
+struct ab_rx_stats
+{
+    uint32_t frames = 0;     // received datagrams
+    uint32_t bytes = 0;      // received bytes
+    uint32_t bad_short = 0;  // dropped: shorter than header and checksum
+    uint32_t bad_magic = 0;  // dropped: no AA 55 at the start
+    uint32_t bad_length = 0; // dropped: length field does not match the datagram
+    uint32_t bad_crc = 0;    // dropped: wrong checksum
+    uint32_t oversized = 0;  // dropped: datagram larger than the receive buffer
+    uint32_t overflow = 0;   // dropped: receive queue of the receive task full
+    uint32_t hits = 0;       // socket frames passed to at least one callback
+    uint32_t misses = 0;     // socket frames without callback of this id and length
+    uint32_t other = 0;      // valid frames which are no sockets (frame hook)
+    uint32_t duplicate = 0;  // dropped: same ts_id as the last socket frame of the sender (setDedup())
+    uint32_t stale = 0;      // dropped: older ts_id than the last socket frame of the sender (setDedup())
+};
+
+/**
+ * histogram with log2 buckets of a time in microseconds
+ * bucket 0 counts 0 us, bucket i counts 2^(i-1) .. 2^i - 1 us, the last bucket counts everything above
+ */
+struct ab_histogram
+{
+    static constexpr uint8_t buckets = 20; // the last bucket starts at 2^18 us (262 ms)
+    uint32_t count[buckets] = {};
+    /**
+     * add a time
+     * @param us time in microseconds
+     */
+    void add(uint32_t us)
+    {
+        uint8_t bucket = us == 0 ? 0 : (uint8_t)(32 - __builtin_clz(us));
+        count[bucket < buckets ? bucket : buckets - 1]++;
+    }
+    /**
+     * @return sum of all buckets
+     */
+    uint32_t total() const
+    {
+        uint32_t retval = 0;
+        for (uint8_t i = 0; i < buckets; i++)
+            retval += count[i];
+        return retval;
+    }
+};
+
+// snapshot of all counters and histograms
+struct ab_stats
+{
+    ab_rx_stats rx;          // receive path
+    ab_tx_stats tx;          // transmit path
+    ab_histogram callback;   // time of decode and callback per called socket callback in us
+    ab_histogram loop;       // time of loop() calls which handled at least one datagram in us
+};
+
+// counters which the receive and transmit task update while loop() reads them, merged into ab_stats by getStats()
+struct ab_task_counters
+{
+    std::atomic<uint32_t> rx_frames{0};
+    std::atomic<uint32_t> rx_bytes{0};
+    std::atomic<uint32_t> rx_bad_short{0};
+    std::atomic<uint32_t> rx_bad_magic{0};
+    std::atomic<uint32_t> rx_bad_length{0};
+    std::atomic<uint32_t> rx_bad_crc{0};
+    std::atomic<uint32_t> rx_oversized{0};
+    std::atomic<uint32_t> rx_overflow{0};
+    std::atomic<uint32_t> tx_sent{0};
+    std::atomic<uint32_t> tx_failed{0};
+    std::atomic<uint32_t> tx_unicast{0};
+    /**
+     * add to a counter
+     * @param counter one of the counters
+     * @param n amount to add
+     */
+    static void count(std::atomic<uint32_t> &counter, uint32_t n = 1)
+    {
+#ifdef AB_TASK_SUPPORTED
+        // resetStats() may clear the counter concurrently
+        counter.fetch_add(n, std::memory_order_relaxed);
+#else
+        // no tasks, only one writer (no atomic read-modify-write on the ESP8266)
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+#endif
+    }
+    /**
+     * copy the counters into the statistics
+     * @param rx receive counters
+     * @param tx transmit counters
+     */
+    void copyTo(ab_rx_stats &rx, ab_tx_stats &tx) const
+    {
+        rx.frames = rx_frames.load(std::memory_order_relaxed);
+        rx.bytes = rx_bytes.load(std::memory_order_relaxed);
+        rx.bad_short = rx_bad_short.load(std::memory_order_relaxed);
+        rx.bad_magic = rx_bad_magic.load(std::memory_order_relaxed);
+        rx.bad_length = rx_bad_length.load(std::memory_order_relaxed);
+        rx.bad_crc = rx_bad_crc.load(std::memory_order_relaxed);
+        rx.oversized = rx_oversized.load(std::memory_order_relaxed);
+        rx.overflow = rx_overflow.load(std::memory_order_relaxed);
+        tx.sent = tx_sent.load(std::memory_order_relaxed);
+        tx.failed = tx_failed.load(std::memory_order_relaxed);
+        tx.unicast = tx_unicast.load(std::memory_order_relaxed);
+    }
+    /**
+     * set all counters to 0
+     */
+    void reset()
+    {
+        for (std::atomic<uint32_t> *counter : {&rx_frames, &rx_bytes, &rx_bad_short, &rx_bad_magic, &rx_bad_length, &rx_bad_crc,
+                                               &rx_oversized, &rx_overflow, &tx_sent, &tx_failed, &tx_unicast})
+            counter->store(0, std::memory_order_relaxed);
+    }
+};
+
+static_assert(ABSOCK_MAX_SOCKETS > 0 && ABSOCK_MAX_SOCKETS < ABSOCK_CB_NONE, "ABSOCK_MAX_SOCKETS must be between 1 and 254");
+static_assert(ABSOCK_MAX_FRAME_HOOKS > 0, "ABSOCK_MAX_FRAME_HOOKS must be at least 1");
 
 class abus_socket
 {
 private:
     /* data */
-    WiFiUDP Udp;                                            // wifi udp driver
+#if defined(ARDUINO)
+    ab_wifi_transport m_defaultTransport;                   // default transport (wifi udp driver)
+#else
+    ab_posix_transport m_defaultTransport;                  // default transport (posix udp socket)
+#endif
+    ab_transport *m_transport;                              // used datagram transport
     uint16_t m_localUdpPort = 8442;                         // local udp abus port
     IPAddress m_BroadCastIp;                                // broadcast ip address
     uint32_t m_ownNad = 0;                                  // own communication NAD
     ab_socket_config cb_socketInfo[ABSOCK_MAX_SOCKETS];     // callback socket config data
     uint8_t cb_id[ABSOCK_MAX_SOCKETS];                      // callback ids
-    SubscribeCallbackAbSocket cb_fct[ABSOCK_MAX_SOCKETS];   // callback function pointers
+    ab_socket_callback cb_fct[ABSOCK_MAX_SOCKETS];          // callback function pointers
+    uint8_t cb_kind[ABSOCK_MAX_SOCKETS];                    // callback kinds (ab_callback_kind)
+    ab_typed_thunk cb_thunk[ABSOCK_MAX_SOCKETS];            // decoder of typed callbacks
+    uint16_t cb_len[ABSOCK_MAX_SOCKETS];                    // expected header length of the callback socket
+    uint8_t cb_next[ABSOCK_MAX_SOCKETS];                    // next callback with the same socket id (ABSOCK_CB_NONE = end)
+    uint8_t cb_head[256];                                   // first callback per socket id (ABSOCK_CB_NONE = no callback)
+    uint8_t m_dispatchDepth = 0;                            // >0 while callbacks are called, removed ones stay linked until the end
+    bool m_cbRemoved = false;                               // callbacks were marked AB_CB_REMOVED during the dispatch
+    int m_pendingLen = 0;                                   // length of a datagram already fetched with parsePacketFrom() but not handled yet
+    uint32_t m_pendingIp = 0;                               // sender of the fetched datagram
+    uint16_t m_pendingPort = 0;
+    char m_rxInline[MAX_DATA_LEN];                          // receive buffer up to MAX_DATA_LEN bytes
+    char *m_rxBuf = m_rxInline;                             // receive buffer (m_rxInline or allocated by the constructor)
+    uint16_t m_rxBufSize = MAX_DATA_LEN;                    // size of the receive buffer = largest accepted datagram
+    uint8_t m_logLevel = ABSOCK_LOG_LEVEL;                  // printed messages (ab_log_level)
+    std::atomic<ab_trace *> m_trace{NULL};                  // event trace (NULL = no trace), also used by the tasks
+    std::atomic<ab_capture_sink *> m_capture{NULL};         // receiver of the raw frames (NULL = no capture), also used by the tasks
+    ab_mirror_target *m_mirror = NULL;                      // latest tag values of the received sockets (NULL = no mirror)
+    ab_dedup *m_dedup = NULL;                               // last ts_id per sender and socket id (NULL = no suppression)
+    ab_frame_hook m_frameHook[ABSOCK_MAX_FRAME_HOOKS] = {}; // receivers of the frames which are no sockets (0 = setFrameHook())
+    void *m_frameHookCtx[ABSOCK_MAX_FRAME_HOOKS] = {};      // contexts of the frame hooks
+#if ABSOCK_TX_QUEUE_LEN > 0
+    ab_spsc_ring<ab_tx_frame, ABSOCK_TX_QUEUE_LEN> m_txQueue; // encoded frames waiting for the transport
+#endif
+    ab_tx_stats m_txStats;                                  // counters of the transmit path which only loop() updates
+    ab_rx_stats m_rxStats;                                  // counters of the receive path which only loop() updates
+    ab_task_counters m_taskStats;                           // counters which the receive and transmit task update
+    ab_histogram m_cbTime;                                  // execution time of the socket callbacks
+    ab_histogram m_loopTime;                                // service time of loop()
+#if ABSOCK_ID_STATS
+    // counters of a registered socket id, kept at the first callback entry of its chain (cb_head)
+    uint32_t m_idHits[ABSOCK_MAX_SOCKETS];                  // socket frames passed to a callback
+    uint32_t m_idMisses[ABSOCK_MAX_SOCKETS];                // socket frames without matching callback
+#endif
+#if ABSOCK_TX_SLOTS > 0
+    ab_tx_slot m_txSlots[ABSOCK_TX_SLOTS];                  // coalescing slots of socket ids with a minimum send interval
+#endif
+#if ABSOCK_MAX_PUBLISHERS > 0
+    ab_publisher m_publishers[ABSOCK_MAX_PUBLISHERS];       // outbound sockets with change detection
+#endif
+#if ABSOCK_NAD_CACHE_LEN > 0
+    ab_nad_cache<ABSOCK_NAD_CACHE_LEN> m_nadCache;          // addresses of the NADs learned from received frames
+#endif
+#ifdef AB_TASK_SUPPORTED
+    ab_mutex m_txRateLock;                                  // guards the token bucket, loop() and the transmit task may both send
+#endif
+    std::atomic<uint32_t> m_txRateCost{0};                  // time credit of one frame in us (0 = no rate limit)
+    uint32_t m_txRateBurst = 1;                             // maximum amount of frames sent back to back
+    uint32_t m_txRateCredit = 0;                            // collected time credit in us
+    uint32_t m_txRateLast = 0;                              // time of the last credit update in us
+#ifdef AB_TASK_SUPPORTED
+    ab_task m_txTask;                                       // optional task which empties the transmit queue
+    /**
+     * function of the transmit task
+     * @param arg abus_socket instance
+     */
+    static void txTaskFunction(void *arg);
+#endif
+#ifdef ABSOCK_RX_TASK
+    ab_spsc_ring<ab_rx_frame, ABSOCK_RX_QUEUE_LEN> m_rxQueue; // checked frames of the receive task
+    char *m_rxArena = NULL;                                 // receive buffers of the queue entries (allocated by startRxTask())
+    uint32_t m_rxSlot = 0;                                  // amount of queued frames (selects the receive buffer)
+    ab_task m_rxTask;                                       // optional task which receives and checks the datagrams
+    /**
+     * function of the receive task
+     * @param arg abus_socket instance
+     */
+    static void rxTaskFunction(void *arg);
+    /**
+     * read the current datagram from the udp driver, check it and add it to the receive queue
+     * @param len length of the datagram returned by parsePacketFrom()
+     * @param ip ip address of the sender
+     * @param port udp port of the sender
+     */
+    void queuePacket(int len, uint32_t ip, uint16_t port);
+#endif
+    /**
+     * read the current datagram from the udp driver and forward it to the socket callbacks
+     * @param len length of the datagram returned by parsePacketFrom()
+     * @param ip ip address of the sender
+     * @param port udp port of the sender
+     */
+    void handlePacket(int len, uint32_t ip, uint16_t port);
+    /**
+     * allocate the receive buffer
+     * @param size size of the receive buffer
+     */
+    void initRxBuffer(uint16_t size);
+    /**
+     * read the current datagram from the udp driver and check it
+     * a datagram which is too large or has a wrong header start is dropped before the rest of it is read and checksummed
+     * @param recbuf receive buffer with m_rxBufSize bytes
+     * @param len length of the datagram returned by parsePacketFrom()
+     * @return AB_PACKET_OK = valid frame in recbuf
+     */
+    ab_packet_check readPacket(char *recbuf, int len);
+    /**
+     * count a received datagram (and the drop reason of an invalid one)
+     * @param len length of the datagram
+     * @param check result of the check
+     * @return check
+     */
+    ab_packet_check countPacket(int len, ab_packet_check check);
+    /**
+     * pass a received datagram to the capture
+     * @param capture receiver of the frames
+     * @param recbuf receive buffer with the datagram
+     * @param len length of the datagram
+     */
+    void captureRx(ab_capture_sink *capture, const char *recbuf, int len);
+    /**
+     * record a receive event in the trace
+     * @param event AB_TRACE_RX, AB_TRACE_RX_DROP, AB_TRACE_RX_OTHER or AB_TRACE_RX_DUP
+     * @param sock_id socket id of the frame
+     * @param nad sender NAD
+     * @param len length of the datagram
+     * @param result meaning depends on the event
+     */
+    void traceRx(uint8_t event, uint8_t sock_id, uint32_t nad, int len, uint8_t result);
+    /**
+     * check a received datagram and count it (the drop reason of an invalid one)
+     * @param recbuf receive buffer with the datagram (m_rxBufSize bytes)
+     * @param len length of the datagram (larger than m_rxBufSize = truncated)
+     * @return AB_PACKET_OK = valid frame
+     */
+    ab_packet_check checkPacket(char *recbuf, int len);
+    /**
+     * forward a checked frame to the socket callbacks
+     * @param recbuf receive buffer with the frame
+     * @param len length of the frame
+     * @param ip ip address of the sender (network byte order, 0 = unknown, the address is not learned)
+     * @param port udp port of the sender
+     */
+    void dispatchPacket(char *recbuf, int len, uint32_t ip, uint16_t port);
+    /**
+     * clear all callbacks and the dispatch table
+     */
+    void initCallbacks();
+    /**
+     * add a callback to the dispatch table
+     * @param config socket configuration informations
+     * @param kind kind of the callback function
+     * @param cbFunction callback function
+     * @return return the handle number of the socket (0 = error, >0 = handler)
+     */
+    uint8_t addCallback(const ab_socket_config &config, uint8_t kind, ab_socket_callback cbFunction);
+    /**
+     * remove a callback from its socket id chain and free the entry
+     * @param pos position of the callback in the dispatch table
+     */
+    void unlinkCallback(uint8_t pos);
+    /**
+     * encode and send out a socket (ab_socket or ab_fixed_socket)
+     * @param socket the socket to send out
+     * @param publish true = only send on changes (see publish())
+     * @param destNad NAD of the receiver (0 = broadcast)
+     */
+    template <class S>
+    ab_send_result sendSocketData(const S &socket, bool publish, uint32_t destNad);
+    /**
+     * encode and send out a socket with a compile time layout
+     * @param sock_id the socket id
+     * @param values tag data of the socket
+     * @param sender NAD of the sender (0 = own NAD)
+     * @param publish true = only send on changes (see publish())
+     * @param destNad NAD of the receiver (0 = broadcast)
+     */
+    template <class Layout>
+    ab_send_result sendLayout(uint8_t sock_id, const typename Layout::data &values, uint32_t sender, bool publish, uint32_t destNad);
+    /**
+     * encode a frame and send it if the tag data changed since the last frame of the publisher (or the heartbeat is due)
+     * sockets without publisher are always sent
+     * @param sock_id socket id of the frame
+     * @param encode function which encodes the frame into a buffer (see sendEncoded())
+     * @return result of the send request (AB_SEND_UNCHANGED = nothing sent)
+     */
+    template <class E>
+    ab_send_result publishEncoded(uint8_t sock_id, E encode);
+    /**
+     * send the last frame of all publishers with an expired heartbeat interval again
+     */
+    void heartbeatTx();
+    /**
+     * encode a frame into the transmit queue (or the transmit buffer of the transport without queue)
+     * @param sock_id socket id of the frame
+     * @param encode function which encodes the frame into a buffer: size_t encode(char *data, size_t len), returns the frame length (0 = error)
+     * @return result of the send request
+     */
+    template <class E>
+    ab_send_result sendEncoded(uint8_t sock_id, E encode);
+    /**
+     * publish the frame which has been encoded into the next free entry of the transmit queue
+     * @param len length of the frame
+     */
+    void commitTxFrame(size_t len);
+    /**
+     * get the unicast address of a frame from the destination NAD in its header
+     * @param data encoded frame
+     * @param ip receives the ip address (network byte order, 0 = broadcast)
+     * @param port receives the udp port
+     */
+    void resolveNad(const char *data, uint32_t &ip, uint16_t &port);
+    /**
+     * hand the waiting frames of the coalescing slots to the transmit queue if their interval is over
+     */
+    void scheduleTx();
+    /**
+     * take the time credit of one frame from the global rate limit
+     * @return true = frame may be sent
+     */
+    bool takeTxToken();
+    /**
+     * record a transmit event in the trace
+     * @param event AB_TRACE_TX or AB_TRACE_TX_DROP
+     * @param sock_id socket id of the frame
+     * @param data pointer to the frame (NULL = not encoded)
+     * @param datalen length of the frame
+     * @param result result of the send request
+     */
+    void traceTx(uint8_t event, uint8_t sock_id, const char *data, size_t datalen, ab_send_result result);
+    /**
+     * hand a frame to the transport
+     * @param data pointer to the frame
+     * @param datalen length of the frame
+     * @param ip ip address of a unicast frame (network byte order, 0 = broadcast)
+     * @param port udp port of a unicast frame
+     * @return AB_SEND_OK or AB_SEND_FAILED
+     */
+    ab_send_result sendFrame(const char *data, size_t datalen, uint32_t ip = 0, uint16_t port = 0);
+    /**
+     * send the frames in the transmit queue
+     * @param maxFrames maximum amount of frames to send (0 = all)
+     * @return amount of sent frames
+     */
+    uint16_t flushQueue(uint16_t maxFrames);
+    ab_fixed_socket m_rxSocket;                             // receive buffer for callbacks with inline storage
 public:
     /**
      * * abus_socket 
@@ -108,8 +662,20 @@ public:
      * constructor with fixed NAd and different abus port
      * @param  {uint16_t} localUdpPort : local abus udp port to listen on
      * @param  {uint32_t} NAD          : communication NAD (network address)
+     * @param  {uint16_t} rxBufferSize : largest accepted datagram (above MAX_DATA_LEN the buffer is allocated once)
      */
-    abus_socket(uint16_t localUdpPort, uint32_t NAD);
+    abus_socket(uint16_t localUdpPort, uint32_t NAD, uint16_t rxBufferSize = MAX_DATA_LEN);
+    /**
+     * * abus_socket 
+     * constructor with a different datagram transport
+     * @param  {ab_transport} transport    : transport which is used instead of the default one (must outlive this object)
+     * @param  {uint16_t} localUdpPort : local abus udp port to listen on
+     * @param  {uint32_t} NAD          : communication NAD (network address, 0 = derived from the transport)
+     * @param  {uint16_t} rxBufferSize : largest accepted datagram (above MAX_DATA_LEN the buffer is allocated once)
+     */
+    abus_socket(ab_transport &transport, uint16_t localUdpPort = 8442, uint32_t NAD = 0, uint16_t rxBufferSize = MAX_DATA_LEN);
+    abus_socket(const abus_socket &) = delete;
+    abus_socket &operator=(const abus_socket &) = delete;
     /**
      * * ~abus_socket 
      * deconstructor
@@ -140,24 +706,263 @@ public:
         this function should be called in the main cycle to handle all incoming messages
     */
     void loop();
+    /**
+        cyclic loop for receive handling of Abus messages which drains all queued datagrams in one call
+        @param maxPackets maximum amount of datagrams to handle in this call (0 = no limit)
+        @param maxMicros time budget for this call in microseconds (0 = no limit)
+        @return amount of handled datagrams and if there are still datagrams waiting
+    */
+    ab_loop_result loop(uint16_t maxPackets, uint32_t maxMicros = 0);
     /**
      * send out a abus socket message
-     * @param ab_socket the socket to send out
+     * the frame is added to the transmit queue and sent by loop() / flush() or the transmit task
+     * @param socket the socket to send out
+     * @param destNad NAD of the receiver, the frame is sent as unicast if its address has been learned (0 / unknown = broadcast)
+     * @return AB_SEND_QUEUED, AB_SEND_QUEUE_FULL (frame dropped) or AB_SEND_INVALID (AB_SEND_OK / AB_SEND_FAILED without queue)
+    */
+    ab_send_result sendSocket(const ab_socket &socket, uint32_t destNad = 0);
+    /**
+     * send out a abus socket message without any heap allocation
+     * @param socket the socket with inline storage to send out
+     * @param destNad NAD of the receiver, the frame is sent as unicast if its address has been learned (0 / unknown = broadcast)
+     * @return AB_SEND_QUEUED, AB_SEND_QUEUE_FULL (frame dropped) or AB_SEND_INVALID (AB_SEND_OK / AB_SEND_FAILED without queue)
     */
-    void sendSocket(ab_socket);
+    ab_send_result sendSocket(const ab_fixed_socket &socket, uint32_t destNad = 0);
     /**
-     * send a raw message on the network
+     * send a raw message on the network immediately (it bypasses the transmit queue), unicast if the destination NAD of the header is known
+     * while the transmit task is running the message is added to the transmit queue instead (see queueRaw()),
+     * so the transport is only used by the transmit task
      * @param data pointer to send data buffer
      * @param datalen datalength to seond out
+     * @return AB_SEND_OK or AB_SEND_FAILED (AB_SEND_QUEUED, AB_SEND_QUEUE_FULL or AB_SEND_INVALID with transmit task)
     */
-    void sendRaw(char *data, size_t datalen);
+    ab_send_result sendRaw(char *data, size_t datalen);
+    /**
+     * add a complete encoded frame (header, data, ts_id and crc) to the transmit queue
+     * the frame is sent as unicast if the destination NAD of its header is known
+     * @param data pointer to the frame
+     * @param datalen length of the frame
+     * @return AB_SEND_QUEUED, AB_SEND_QUEUE_FULL or AB_SEND_INVALID (AB_SEND_OK / AB_SEND_FAILED without queue)
+     */
+    ab_send_result queueRaw(const char *data, size_t datalen);
+    /**
+     * set the receiver of all valid frames which are no socket frames (header.dir != 1 or header.typ == 0)
+     * there is one hook of the application, a new one replaces the previous one; the hooks of addFrameHook() are kept
+     * @param hook function which is called from loop() with the checked frame (NULL = remove the hook)
+     * @param ctx context which is passed to the hook
+     */
+    void setFrameHook(ab_frame_hook hook, void *ctx = NULL);
+    /**
+     * add a further receiver of the frames which are no socket frames (e.g. abus_client), every hook gets every frame
+     * @param hook function which is called from loop() with the checked frame
+     * @param ctx context which is passed to the hook
+     * @return true = added, false = no free entry (ABSOCK_MAX_FRAME_HOOKS)
+     */
+    bool addFrameHook(ab_frame_hook hook, void *ctx = NULL);
+    /**
+     * remove a hook of addFrameHook()
+     * @param hook function of the hook
+     * @param ctx context of the hook
+     * @return true = removed
+     */
+    bool removeFrameHook(ab_frame_hook hook, void *ctx = NULL);
+    /**
+     * @return own communication NAD (valid after begin())
+     */
+    uint32_t getOwnNad() const;
+    /**
+     * select the printed messages of this instance (the messages have to be compiled in with ABSOCK_DEBUG / ABSOCK_ERROR)
+     * @param level AB_LOG_NONE, AB_LOG_ERROR or AB_LOG_DEBUG
+     */
+    void setLogLevel(ab_log_level level);
+    /**
+     * @return level of the printed messages
+     */
+    ab_log_level logLevel() const;
+    /**
+     * record the received and sent frames in a binary event trace
+     * the receive and transmit task record their events as well (ab_trace accepts concurrent writers)
+     * @param trace event trace, it has to outlive the socket (NULL = stop tracing)
+     */
+    void setTrace(ab_trace *trace);
+    /**
+     * capture every received datagram and every sent frame with a time stamp (see abus_capture.h)
+     * the receive and transmit task write into the sink as well, see ab_capture_sink::write()
+     * @param capture receiver of the frames, it has to outlive the socket (NULL = stop capturing)
+     */
+    void setCapture(ab_capture_sink *capture);
+    /**
+     * keep the latest tag values of the received sockets in a tag mirror (see abus_tag_mirror.h)
+     * the mirror is updated by loop() before the callbacks of the frame, a mirrored frame counts as dispatch hit
+     * @param mirror tag mirror, it has to outlive the socket (NULL = no mirror)
+     */
+    void setMirror(ab_mirror_target *mirror);
+    /**
+     * drop socket frames whose ts_id is the same as or older than the last one of the sender and socket id (see abus_dedup.h)
+     * the frames are dropped before they are decoded and counted in getStats().rx.duplicate / stale
+     * @param dedup ts_id table, it has to outlive the socket (NULL = deliver every frame)
+     */
+    void setDedup(ab_dedup *dedup);
+    /**
+     * handle a frame as if it has been received, e.g. a captured frame (see ab_replay())
+     * it passes the same checks and callbacks as a received datagram, but its sender address is not learned and it is not captured
+     * @param data pointer to the frame
+     * @param len length of the frame
+     */
+    void processFrame(const char *data, size_t len);
+    /**
+     * @return size of the receive buffer = largest accepted datagram
+     */
+    uint16_t rxBufferSize() const;
+    /**
+     * send the frames in the transmit queue, loop() calls it as well
+     * waiting frames of the coalescing slots are queued first, the queue is not sent while the transmit task is running
+     * @param maxFrames maximum amount of frames to send (0 = all)
+     * @return amount of sent frames
+     */
+    uint16_t flush(uint16_t maxFrames = 0);
+    /**
+     * send a socket id at most every minIntervalMs milliseconds
+     * a frame within the interval waits in a coalescing slot and is replaced by newer frames of the same socket id (latest value wins),
+     * the waiting frame is queued by loop() / flush() after the interval
+     * @param sock_id socket id
+     * @param minIntervalMs minimum send interval in milliseconds (0 = remove the limit, a waiting frame is discarded)
+     * @return true = successful, false = no free slot (ABSOCK_TX_SLOTS)
+     */
+    bool setSendInterval(uint8_t sock_id, uint16_t minIntervalMs);
+    /**
+     * register an outbound socket which is only sent by publish() if its tag data changed
+     * bit, int and long tags are sent on every change, real tags if they moved by more than their deadband
+     * @param config socket configuration (id, amount of bit, int, long and real tags)
+     * @param heartbeatMs the last frame is sent again by loop() after this interval without change (0 = no heartbeat)
+     * @param deadbands table with config.realcount deadbands, it has to outlive the publisher (NULL = every change is sent)
+     * @return handle of the publisher (0 = error / no free entry, ABSOCK_MAX_PUBLISHERS)
+     */
+    uint8_t addPublisher(ab_socket_config config, uint16_t heartbeatMs = 0, const ab_deadband *deadbands = NULL);
+    /**
+     * remove a publisher
+     * @param handle handle of the publisher
+     * @return true = successful
+     */
+    bool removePublisher(uint8_t handle);
+    /**
+     * send out a socket of a publisher if its tag data changed since the last sent frame or the heartbeat is due
+     * sockets without publisher are sent like sendSocket()
+     * @param socket the socket to send out
+     * @return AB_SEND_UNCHANGED (nothing sent) or the result of sendSocket()
+     */
+    ab_send_result publish(const ab_socket &socket);
+    /**
+     * send out a socket with inline storage of a publisher if its tag data changed since the last sent frame or the heartbeat is due
+     * @param socket the socket to send out
+     * @return AB_SEND_UNCHANGED (nothing sent) or the result of sendSocket()
+     */
+    ab_send_result publish(const ab_fixed_socket &socket);
+    /**
+     * send out a socket with a compile time layout if its tag data changed since the last sent frame or the heartbeat is due
+     * @param sock_id the socket id
+     * @param values tag data of the socket
+     * @param sender NAD of the sender (0 = own NAD)
+     * @return AB_SEND_UNCHANGED (nothing sent) or the result of sendSocket()
+     */
+    template <class Layout>
+    ab_send_result publish(uint8_t sock_id, const typename Layout::data &values, uint32_t sender = 0);
+    /**
+     * address of a NAD learned from its received frames
+     * @param nad NAD
+     * @param ip receives the ip address
+     * @param port receives the udp port
+     * @return true = NAD known
+     */
+    bool getNadAddress(uint32_t nad, IPAddress &ip, uint16_t &port);
+    /**
+     * remove a NAD from the address cache, frames to it are sent as broadcast until it is learned again
+     * @param nad NAD (0 = clear the whole cache)
+     */
+    void forgetNad(uint32_t nad);
+    /**
+     * limit the rate of all sent frames (token bucket), frames above the rate stay in the transmit queue
+     * @param maxPacketsPerSecond maximum frames per second (0 = no limit)
+     * @param burst maximum amount of frames which can be sent back to back
+     */
+    void setSendRate(uint16_t maxPacketsPerSecond, uint8_t burst = 1);
+    /**
+     * @return amount of frames in the transmit queue
+     */
+    uint16_t txQueueLength() const;
+    /**
+     * @return counters of the transmit path (sent, failed and dropped frames)
+     */
+    ab_tx_stats getTxStats() const;
+    /**
+     * snapshot of all counters and histograms (the counters may be updated by the transmit and receive task meanwhile)
+     * @return counters of the receive and transmit path, callback and loop() time histograms
+     */
+    ab_stats getStats() const;
+    /**
+     * dispatch counters of a socket id with at least one callback (ABSOCK_ID_STATS), counted since its first callback
+     * @param sock_id socket id
+     * @param hits receives the amount of frames passed to a callback
+     * @param misses receives the amount of frames without matching callback
+     * @return false = no callback for the socket id or no per id counters compiled in
+     */
+    bool getSocketStats(uint8_t sock_id, uint32_t &hits, uint32_t &misses) const;
+    /**
+     * set all counters and histograms to 0
+     */
+    void resetStats();
+#ifdef AB_TASK_SUPPORTED
+    /**
+     * start a task which sends the queued frames as soon as they are queued, loop() does not send them anymore
+     * @param stackSize stack size of the task in bytes (ESP32 only)
+     * @param priority priority of the task (ESP32 only)
+     * @param core cpu core of the task (ESP32 only, -1 = any core)
+     * @return true = task started
+     */
+    bool startTxTask(uint32_t stackSize = 4096, uint8_t priority = 1, int core = -1);
+    /**
+     * stop the transmit task, the queue is emptied by loop() / flush() again
+     */
+    void stopTxTask();
+#endif
+#ifdef ABSOCK_RX_TASK
+    /**
+     * start a task which receives and checks the datagrams and queues the valid frames (ABSOCK_RX_QUEUE_LEN)
+     * loop() only takes the queued frames and calls the callbacks, so a slow main loop does not delay the receiving;
+     * frames which do not fit into the full queue are dropped and counted (getStats().rx.overflow)
+     * on the task run: the transport, the capture sink (setCapture()), the trace (setTrace()) and the drop counters;
+     * the callbacks, frame hooks, the tag mirror, the dedup filter and the NAD cache stay in loop()
+     * @param stackSize stack size of the task in bytes (ESP32 only)
+     * @param priority priority of the task (ESP32 only)
+     * @param core cpu core of the task (ESP32 only, -1 = any core)
+     * @return true = task started
+     */
+    bool startRxTask(uint32_t stackSize = 4096, uint8_t priority = 2, int core = -1);
+    /**
+     * stop the receive task, loop() reads the datagrams itself again
+     */
+    void stopRxTask();
+    /**
+     * @return amount of frames in the receive queue
+     */
+    uint16_t rxQueueLength() const;
+#endif
     /**
      * set a callback for a specific socket with the given configuration
+     * several callbacks can listen on the same socket id, they are called in registration order
      * @param config socket configuration informations (id, amount of bit, int, long and real tags)
      * @param cbFunction callback function name which is triggered after the socket is received
      * @return return the handle number of the socket (0 = error, >0 = handler)
     */
     uint8_t setSocketCallback(ab_socket_config config, SubscribeCallbackAbSocket cbFunction);
+    /**
+     * set a callback for a specific socket with the given configuration
+     * the socket is passed by reference and decoded without any heap allocation
+     * @param config socket configuration informations (id, amount of bit, int, long and real tags)
+     * @param cbFunction callback function name which is triggered after the socket is received
+     * @return return the handle number of the socket (0 = error or more tags than ab_fixed_socket holds, >0 = handler)
+    */
+    uint8_t setSocketCallback(ab_socket_config config, SubscribeCallbackAbFixedSocket cbFunction);
     /**
      * set a callback for a specific socket with the given configuration
      * @param sock_id the socket id to listen on
@@ -170,55 +975,160 @@ public:
      */
     uint8_t setSocketCallback(uint8_t sock_id, uint8_t bitcount, uint8_t intcount, uint8_t longcount, uint8_t realcount, SubscribeCallbackAbSocket cbFunction);
     /**
-     * remove / delete a socket callback function
-     * @param handler the handler of the socket callback which should be deleted
-     * @return true = succesful, false = error / no callback found
+     * set a callback for a specific socket with the given configuration
+     * the socket is passed by reference and decoded without any heap allocation
+     * @param sock_id the socket id to listen on
+     * @param bitcount the amount of bit values in the socket
+     * @param intcount the amount of integer values in the socket
+     * @param longcount the amount of long values in the socket
+     * @param realcount the amount of real values in the socket
+     * @param cbFunction callback function name which is triggered after the socket is received
+     * @return return the handle number of the socket (0 = error or more tags than ab_fixed_socket holds, >0 = handler)
+     */
+    uint8_t setSocketCallback(uint8_t sock_id, uint8_t bitcount, uint8_t intcount, uint8_t longcount, uint8_t realcount, SubscribeCallbackAbFixedSocket cbFunction);
+    /**
+     * set a callback for a specific socket with the given configuration
+     * the callback receives a view into the receive buffer, tags are only decoded on access
+     * @param config socket configuration informations (id, amount of bit, int, long and real tags)
+     * @param cbFunction callback function name which is triggered after the socket is received
+     * @return return the handle number of the socket (0 = error, >0 = handler)
     */
-    bool removeSocketCallback(uint8_t handle);
-};
-
-// code implementations
-
-abus_socket::abus_socket()
-{
+    uint8_t setSocketCallback(ab_socket_config config, SubscribeCallbackAbSocketView cbFunction);
+    /**
+     * set a callback for a specific socket with the given configuration
+     * the callback receives a view into the receive buffer, tags are only decoded on access
+     * @param sock_id the socket id to listen on
+     * @param bitcount the amount of bit values in the socket
+     * @param intcount the amount of integer values in the socket
+     * @param longcount the amount of long values in the socket
+     * @param realcount the amount of real values in the socket
+     * @param cbFunction callback function name which is triggered after the socket is received
+     * @return return the handle number of the socket (0 = error, >0 = handler)
+     */
+    uint8_t setSocketCallback(uint8_t sock_id, uint8_t bitcount, uint8_t intcount, uint8_t longcount, uint8_t realcount, SubscribeCallbackAbSocketView cbFunction);
+    /**
+     * set the same callback for several sockets in one pass (e.g. all sockets of an ab_schema)
+     * either all sockets are added or none, the handles are consecutive free entries in registration order
+     * the callback receives a view into the receive buffer, tags are only decoded on access
+     * @param configs socket configurations
+     * @param count amount of socket configurations
+     * @param cbFunction callback function name which is triggered after one of the sockets is received
+     * @return amount of added callbacks (0 = error / not enough free entries, ABSOCK_MAX_SOCKETS)
+     */
+    uint8_t setSocketCallbacks(const ab_socket_config *configs, uint8_t count, SubscribeCallbackAbSocketView cbFunction);
+    /**
+     * set a callback for a specific socket with a compile time layout
+     * the callback receives the plain tag data structure of the layout
+     * usage: abSock.setSocketCallback<ab_socket_layout<1, 1, 1, 1>>(3, cbFunction);
+     * @param sock_id the socket id to listen on
+     * @param cbFunction callback function name which is triggered after the socket is received
+     * @return return the handle number of the socket (0 = error, >0 = handler)
+     */
+    template <class Layout>
+    uint8_t setSocketCallback(uint8_t sock_id, typename Layout::callback cbFunction);
+    /**
+     * send out a abus socket message with a compile time layout
+     * usage: abSock.sendSocket<ab_socket_layout<1, 1, 1, 1>>(3, values);
+     * @param sock_id the socket id
+     * @param values tag data of the socket
+     * @param sender NAD of the sender (0 = own NAD)
+     * @param destNad NAD of the receiver, the frame is sent as unicast if its address has been learned (0 / unknown = broadcast)
+     * @return result of the send request (see sendSocket(const ab_socket &))
+     */
+    template <class Layout>
+    ab_send_result sendSocket(uint8_t sock_id, const typename Layout::data &values, uint32_t sender = 0, uint32_t destNad = 0);
+    /**
+     * remove / delete a socket callback function
+     * may be called from a callback, a removed callback is not called again for the current frame
+     * and its handle is freed after the frame
+     * @param handler the handler of the socket callback which should be deleted
+     * @return true = succesful, false = error / no callback found
+    */
+    bool removeSocketCallback(uint8_t handle);
+};
+
+// code implementations
+
+abus_socket::abus_socket()
+{
+    m_transport = &m_defaultTransport;
+    initCallbacks();
 }
 abus_socket::abus_socket(uint32_t NAD)
 {
+    m_transport = &m_defaultTransport;
     m_ownNad = NAD;
+    initCallbacks();
 }
-abus_socket::abus_socket(uint16_t localUdpPort, uint32_t NAD)
+abus_socket::abus_socket(uint16_t localUdpPort, uint32_t NAD, uint16_t rxBufferSize)
 {
+    m_transport = &m_defaultTransport;
     m_localUdpPort = localUdpPort;
     m_ownNad = NAD;
+    initCallbacks();
+    initRxBuffer(rxBufferSize);
+}
+abus_socket::abus_socket(ab_transport &transport, uint16_t localUdpPort, uint32_t NAD, uint16_t rxBufferSize)
+{
+    m_transport = &transport;
+    m_localUdpPort = localUdpPort;
+    m_ownNad = NAD;
+    initCallbacks();
+    initRxBuffer(rxBufferSize);
 }
 abus_socket::~abus_socket()
 {
-    Udp.stop();
+#ifdef ABSOCK_RX_TASK
+    m_rxTask.stop();
+#endif
+#ifdef AB_TASK_SUPPORTED
+    m_txTask.stop();
+#endif
+    m_transport->stop();
+#ifdef ABSOCK_RX_TASK
+    delete[] m_rxArena;
+#endif
+    if (m_rxBuf != m_rxInline)
+        delete[] m_rxBuf;
+}
+void abus_socket::initRxBuffer(uint16_t size)
+{
+    // the smallest frame has a header and a checksum
+    if (size < 18)
+        size = 18;
+    if (size > sizeof(m_rxInline))
+    {
+        m_rxBuf = new (std::nothrow) char[size];
+        if (m_rxBuf == NULL)
+        {
+            ABSOCK_ERR_PRINTF("*AB: no memory for a receive buffer of %u bytes!\n", size);
+            m_rxBuf = m_rxInline;
+            size = sizeof(m_rxInline);
+        }
+    }
+    m_rxBufSize = size;
 }
 void abus_socket::begin()
 {
 #if defined(ESP8266)
     if (!m_BroadCastIp.isSet())
-    {
-        //ABSOCK_DBG_PRINTLN(F("*AB: calc broadcast IP from WiFi IP"));
-        m_BroadCastIp = WiFi.localIP().v4() | ~WiFi.subnetMask().v4();
-    }
 #elif defined(ESP32)
     if (m_BroadCastIp == IPAddress(INADDR_ANY) ||
         m_BroadCastIp == IPAddress(INADDR_NONE))
+#else
+    if ((uint32_t)m_BroadCastIp == 0)
+#endif
     {
-        //ABSOCK_DBG_PRINTLN(F("*AB: calc broadcast IP from WiFi IP"));
-        m_BroadCastIp = WiFi.localIP() | ~WiFi.subnetMask();
+        //ABSOCK_DBG_PRINTLN(F("*AB: calc broadcast IP from transport"));
+        m_BroadCastIp = m_transport->broadcastIP();
     }
-#endif
     if (!m_ownNad)
+        m_ownNad = m_transport->defaultNad();
+    if (!m_transport->begin(m_localUdpPort))
     {
-        char mac[12];
-        WiFi.macAddress().toCharArray(mac, sizeof(mac), 0);
-        m_ownNad = mac[0] | mac[1] << 8L | mac[2] << 16L | mac[3] << 24L;
+        ABSOCK_ERR_PRINTLN(F("*AB: begin()->transport failed!"));
     }
-    Udp.begin(m_localUdpPort);
-    ABSOCK_DBG_PRINTF("*AB: begin()->bCastIP=%s, port=%d, nad=%lu\n", m_BroadCastIp.toString().c_str(), m_localUdpPort, (long uint16_t)m_ownNad);
+    ABSOCK_DBG_PRINTF("*AB: begin()->bCastIP=%s, port=%d, nad=%lu\n", m_BroadCastIp.toString().c_str(), m_localUdpPort, (unsigned long)m_ownNad);
 
 }
 void abus_socket::begin(uint16_t localUdpPort)
@@ -239,139 +1149,1049 @@ void abus_socket::begin(IPAddress bCastIP, uint16_t localUdpPort)
 }
 void abus_socket::loop()
 {
-    int len = Udp.parsePacket();
-    if (len > 0)
+    loop(1);
+}
+ab_loop_result abus_socket::loop(uint16_t maxPackets, uint32_t maxMicros)
+{
+    ab_loop_result retval;
+    uint32_t start = micros();
+    // frames queued since the last call go out first
+    flush();
+#ifdef ABSOCK_RX_TASK
+    // frames of the receive task (also the ones left after stopRxTask()), dispatched in place
+    ab_rx_frame *frame;
+    while ((frame = m_rxQueue.readSlot()) != NULL)
     {
-        //ABSOCK_DBG_PRINTF("*AB: rec-len=%d, ", len);
-
-        char recbuf[MAX_DATA_LEN];
-        Udp.read(recbuf, sizeof(recbuf));
+        if ((maxPackets > 0 && retval.handled >= maxPackets) ||
+            (maxMicros > 0 && (uint32_t)(micros() - start) >= maxMicros))
+        {
+            retval.pending = m_rxQueue.size();
+            break;
+        }
+        dispatchPacket(frame->data, frame->len, frame->ip, frame->port);
+        m_rxQueue.release();
+        retval.handled++;
+    }
+    // the receive task is the only reader of the transport while it is running
+    if (m_rxTask.running() || retval.pending > 0)
+    {
+        if (retval.handled > 0)
+            m_loopTime.add(micros() - start);
+        return retval;
+    }
+#endif
+    while (true)
+    {
+        // a datagram fetched in the previous call is handled first, parsePacketFrom() would discard it
+        if (m_pendingLen <= 0)
+            m_pendingLen = m_transport->parsePacketFrom(m_pendingIp, m_pendingPort);
+        if (m_pendingLen <= 0)
+        {
+            m_pendingLen = 0;
+            break;
+        }
+        // check the packet and time budget, the fetched datagram is kept for the next call
+        if ((maxPackets > 0 && retval.handled >= maxPackets) ||
+            (maxMicros > 0 && (uint32_t)(micros() - start) >= maxMicros))
+        {
+            retval.pending = 1;
+            break;
+        }
+        int len = m_pendingLen;
+        m_pendingLen = 0;
+        handlePacket(len, m_pendingIp, m_pendingPort);
+        retval.handled++;
+    }
+    if (retval.handled > 0)
+        m_loopTime.add(micros() - start);
+    return retval;
+}
+void abus_socket::handlePacket(int len, uint32_t ip, uint16_t port)
+{
+    //ABSOCK_DBG_PRINTF("*AB: rec-len=%d, ", len);
 
-        if (ab_checkValidPacket(recbuf, min(len, (int)sizeof(recbuf))))
+    if (readPacket(m_rxBuf, len) == AB_PACKET_OK)
+        dispatchPacket(m_rxBuf, len, ip, port);
+}
+ab_packet_check abus_socket::readPacket(char *recbuf, int len)
+{
+    // the capture gets the whole datagram, also an invalid one
+    ab_capture_sink *capture = m_capture.load(std::memory_order_acquire);
+    if (capture != NULL)
+    {
+        m_transport->read(recbuf, m_rxBufSize);
+        captureRx(capture, recbuf, len);
+        return checkPacket(recbuf, len);
+    }
+    // without the capture a bad datagram is dropped before it is copied and checksummed,
+    // the unread rest is discarded by the next parsePacket()
+    if (len > m_rxBufSize)
+        return countPacket(len, AB_PACKET_LENGTH);
+    if (len <= 12 + 2)
+        return countPacket(len, AB_PACKET_SHORT);
+    if (m_transport->read(recbuf, 4) != 4)
+        return countPacket(len, AB_PACKET_SHORT);
+    ab_packet_check check = ab_checkPacketHead(recbuf, len);
+    if (check != AB_PACKET_OK)
+        return countPacket(len, check);
+    m_transport->read(recbuf + 4, len - 4);
+    return checkPacket(recbuf, len);
+}
+void abus_socket::captureRx(ab_capture_sink *capture, const char *recbuf, int len)
+{
+    ab_capture_record rec;
+    rec.time = micros();
+    rec.len = (uint16_t)len;
+    rec.caplen = (uint16_t)min(len, (int)m_rxBufSize);
+    rec.dir = AB_CAPTURE_RX;
+    capture->write(rec, recbuf);
+}
+void abus_socket::traceRx(uint8_t event, uint8_t sock_id, uint32_t nad, int len, uint8_t result)
+{
+    ab_trace *trace = m_trace.load(std::memory_order_acquire);
+    if (trace != NULL)
+        trace->record(event, sock_id, nad, (uint16_t)len, result);
+}
+uint16_t abus_socket::rxBufferSize() const
+{
+    return m_rxBufSize;
+}
+void abus_socket::processFrame(const char *data, size_t len)
+{
+    memcpy(m_rxBuf, data, min(len, (size_t)m_rxBufSize));
+    if (checkPacket(m_rxBuf, (int)len) == AB_PACKET_OK)
+        dispatchPacket(m_rxBuf, (int)len, 0, 0);
+}
+ab_packet_check abus_socket::checkPacket(char *recbuf, int len)
+{
+    // a datagram larger than the receive buffer is truncated by read() and can not be valid
+    return countPacket(len, len > m_rxBufSize ? AB_PACKET_LENGTH : ab_checkPacket(recbuf, len));
+}
+ab_packet_check abus_socket::countPacket(int len, ab_packet_check check)
+{
+    ab_task_counters::count(m_taskStats.rx_frames);
+    ab_task_counters::count(m_taskStats.rx_bytes, len);
+    if (check == AB_PACKET_OK)
+        return check;
+    traceRx(AB_TRACE_RX_DROP, 0, 0, len, check);
+    if (len > m_rxBufSize)
+        ab_task_counters::count(m_taskStats.rx_oversized);
+    else if (check == AB_PACKET_SHORT)
+        ab_task_counters::count(m_taskStats.rx_bad_short);
+    else if (check == AB_PACKET_MAGIC)
+        ab_task_counters::count(m_taskStats.rx_bad_magic);
+    else if (check == AB_PACKET_LENGTH)
+        ab_task_counters::count(m_taskStats.rx_bad_length);
+    else
+        ab_task_counters::count(m_taskStats.rx_bad_crc);
+    return check;
+}
+void abus_socket::dispatchPacket(char *recbuf, int len, uint32_t ip, uint16_t port)
+{
+    ab_header header = ab_getHeader(recbuf, len);
+#if ABSOCK_NAD_CACHE_LEN > 0
+    // remember where the sender can be reached for unicast frames
+    if (ip != 0 && header.from != 0 && header.from != m_ownNad)
+        m_nadCache.learn(header.from, ip, port);
+#else
+    (void)ip;
+    (void)port;
+#endif
+    // we got a socket message
+    if (header.dir == 1u && header.typ > 0u)
+    {
+        // a repeated or late copy of a frame is dropped before any decoding
+        if (m_dedup != NULL)
         {
-            ab_header header = ab_getHeader(recbuf, len);
-            // we got a socket message
-            if (header.dir == 1u && header.typ > 0u)
+            ab_dedup_result dup = m_dedup->check(header.from, header.typ, header.ts_id, millis());
+            if (dup != AB_DEDUP_NEW)
             {
-                ABSOCK_DBG_PRINTF("*AB: rec-len=%d, ", len);
-                ABSOCK_DBG_PRINTF("<SOCK:  ID: %3d: ", header.typ);
-                uint8_t cbPos = 0;
-                // loop through all socket callbacks and forward the socket data for it
-                // the function will only raise the callback if the following criteria are fulfilled:
-                // socket ID is correct
-                // total amount of data is correct (1 bit 2 int and 3 real, socket has 17 byte of data)
-                while (cbPos < ABSOCK_MAX_SOCKETS)
+                if (dup == AB_DEDUP_DUPLICATE)
+                    m_rxStats.duplicate++;
+                else
+                    m_rxStats.stale++;
+                traceRx(AB_TRACE_RX_DUP, header.typ, header.from, len, dup);
+                return;
+            }
+        }
+        ABSOCK_DBG_PRINTF("*AB: rec-len=%d, ", len);
+        ABSOCK_DBG_PRINTF("<SOCK:  ID: %3d: ", header.typ);
+        // the dispatch table holds all callbacks of this socket id in registration order
+        // the function will only raise a callback if the total amount of data is correct
+        // (1 bit 2 int and 3 real, socket has 17 byte of data)
+        uint8_t cbPos = cb_head[header.typ];
+        // the inline receive socket is only decoded again if the layout changes
+        bool rxDecoded = false;
+        bool dispatched = m_mirror != NULL && m_mirror->update(recbuf, len, header);
+        // a callback may remove any callback, the removed entries stay linked (AB_CB_REMOVED) until the pass is done
+        m_dispatchDepth++;
+        while (cbPos != ABSOCK_CB_NONE)
+        {
+            if (cb_len[cbPos] == header.len)
+            {
+                const ab_socket_config &conf = cb_socketInfo[cbPos];
+                // the measured time includes the decoding of the socket
+                uint32_t cbStart = micros();
+                bool called = false;
+                if (cb_kind[cbPos] == AB_CB_FIXED)
                 {
-                    if(cb_id[cbPos] > 0 && cb_socketInfo[cbPos].socket_id == header.typ)
+                    if (!rxDecoded || m_rxSocket.config.bitcount != conf.bitcount || m_rxSocket.config.intcount != conf.intcount ||
+                        m_rxSocket.config.longcount != conf.longcount || m_rxSocket.config.realcount != conf.realcount)
+                        rxDecoded = ab_getSocket(recbuf, len, header, conf, m_rxSocket);
+                    if (rxDecoded)
                     {
-                        ab_socket newSock = ab_getSocket(recbuf, len, header, cb_socketInfo[cbPos]);
-                        if (newSock.socket_valid && cb_fct[cbPos] != NULL)
-                        {
-                            ABSOCK_DBG_PRINTF(" --> cb(%u) ", cbPos);
-                            cb_fct[cbPos](newSock);
-                            break; // stop cycling throught all socket callbacks if we found one
-                        }
+                        ABSOCK_DBG_PRINTF(" --> cb(%u) ", cbPos);
+                        cb_fct[cbPos].fixed(m_rxSocket);
+                        called = true;
                     }
-                    cbPos++;
                 }
-                /*
-                else
+                else if (cb_kind[cbPos] == AB_CB_VIEW)
                 {
-                    ABSOCK_ERR_PRINTLN(F("*AB: *** no socket implemented ***"));
-                } */
-                ABSOCK_DBG_PRINTLN("");
-            }
-            #ifdef ABSOCK_PARSE_NON_SOCKET
-            else
-            {
-                ABSOCK_DBG_PRINTF("*AB: rec-len=%d, ", len);
-                ABSOCK_DBG_PRINTF("<  AB: D%3d, T%1d: ", header.dir, header.typ);
-                ABSOCK_DBG_PRINTF("l=%d, %lu --> %lu, ts=%04X", header.len, header.from, header.to, header.ts_id);
-                ABSOCK_DBG_PRINTF(", Data");
-                int posmax = len;
-                int pos = 14;
-                if (len > (int)sizeof(recbuf))
-                    posmax = sizeof(recbuf);
-                while (pos < posmax - 4)
+                    ab_socket_view view;
+                    if (ab_getSocketView(recbuf, len, header, conf, view))
+                    {
+                        ABSOCK_DBG_PRINTF(" --> cb(%u) ", cbPos);
+                        cb_fct[cbPos].view(view);
+                        called = true;
+                    }
+                }
+                else if (cb_kind[cbPos] == AB_CB_TYPED)
                 {
-                    ABSOCK_DBG_PRINTF(":%02X", recbuf[pos]);
-                    pos++;
+                    ABSOCK_DBG_PRINTF(" --> cb(%u) ", cbPos);
+                    cb_thunk[cbPos](recbuf, header, cb_fct[cbPos].typed);
+                    called = true;
+                }
+                else if (cb_kind[cbPos] == AB_CB_SOCKET)
+                {
+                    ab_socket newSock = ab_getSocket(recbuf, len, header, conf);
+                    if (newSock.socket_valid)
+                    {
+                        ABSOCK_DBG_PRINTF(" --> cb(%u) ", cbPos);
+                        cb_fct[cbPos].socket(newSock);
+                        called = true;
+                    }
+                }
+                if (called)
+                {
+                    m_cbTime.add(micros() - cbStart);
+                    dispatched = true;
                 }
-                ABSOCK_DBG_PRINTLN("");
-
             }
-            #endif       
+            cbPos = cb_next[cbPos];
+        }
+        if (--m_dispatchDepth == 0 && m_cbRemoved)
+        {
+            m_cbRemoved = false;
+            for (uint8_t pos = 0; pos < ABSOCK_MAX_SOCKETS; pos++)
+            {
+                if (cb_id[pos] != 0 && cb_kind[pos] == AB_CB_REMOVED)
+                    unlinkCallback(pos);
+            }
+        }
+        if (dispatched)
+            m_rxStats.hits++;
+        else
+            m_rxStats.misses++;
+        traceRx(AB_TRACE_RX, header.typ, header.from, len, dispatched);
+#if ABSOCK_ID_STATS
+        // socket ids without callback are only counted in the totals
+        uint8_t statPos = cb_head[header.typ];
+        if (statPos != ABSOCK_CB_NONE)
+        {
+            if (dispatched)
+                m_idHits[statPos]++;
+            else
+                m_idMisses[statPos]++;
         }
+#endif
+        /*
+        else
+        {
+            ABSOCK_ERR_PRINTLN(F("*AB: *** no socket implemented ***"));
+        } */
+        ABSOCK_DBG_PRINTLN("");
+    }
+    else
+    {
+        m_rxStats.other++;
+        traceRx(AB_TRACE_RX_OTHER, header.typ, header.from, len, header.dir);
+        for (uint8_t i = 0; i < ABSOCK_MAX_FRAME_HOOKS; i++)
+        {
+            if (m_frameHook[i] != NULL)
+                m_frameHook[i](m_frameHookCtx[i], recbuf, len, header);
+        }
+#ifdef ABSOCK_PARSE_NON_SOCKET
+        ABSOCK_DBG_PRINTF("*AB: rec-len=%d, ", len);
+        ABSOCK_DBG_PRINTF("<  AB: D%3d, T%1d: ", header.dir, header.typ);
+        ABSOCK_DBG_PRINTF("l=%d, %lu --> %lu, ts=%04X", header.len, header.from, header.to, header.ts_id);
+        ABSOCK_DBG_PRINTF(", Data");
+        int posmax = len;
+        int pos = 14;
+        while (pos < posmax - 4)
+        {
+            ABSOCK_DBG_PRINTF(":%02X", recbuf[pos]);
+            pos++;
+        }
+        ABSOCK_DBG_PRINTLN("");
+#endif
     }
 }
-void abus_socket::sendSocket(ab_socket socket)
+ab_send_result abus_socket::sendSocket(const ab_socket &socket, uint32_t destNad)
+{
+    return sendSocketData(socket, false, destNad);
+}
+ab_send_result abus_socket::sendSocket(const ab_fixed_socket &socket, uint32_t destNad)
+{
+    return sendSocketData(socket, false, destNad);
+}
+ab_send_result abus_socket::publish(const ab_socket &socket)
+{
+    return sendSocketData(socket, true, 0);
+}
+ab_send_result abus_socket::publish(const ab_fixed_socket &socket)
+{
+    return sendSocketData(socket, true, 0);
+}
+template <class S>
+ab_send_result abus_socket::sendSocketData(const S &socket, bool publish, uint32_t destNad)
 {
     // check for valid socket
     if (socket.config.socket_id == 0)
     {
         ABSOCK_ERR_PRINTLN(F("*AB: sendSocket()->ID missing!"));
-        return;
+        return AB_SEND_INVALID;
     }
-    if (socket.sender == 0)
+    uint32_t sender = socket.sender;
+    if (sender == 0)
     {
         if (m_ownNad == 0)
         {
             ABSOCK_ERR_PRINTLN(F("*AB: sendSocket()->sender missing!"));
-            return;
+            return AB_SEND_INVALID;
         }
-        socket.sender = m_ownNad;
+        sender = m_ownNad;
     }
     if (socket.bitdata.size() == 0 && socket.intdata.size() == 0 && socket.longdata.size() == 0 && socket.realdata.size() == 0)
     {
         ABSOCK_ERR_PRINTLN(F("*AB: sendSocket()->socketdata empty!"));
-        return;
+        return AB_SEND_INVALID;
     }
-    // generate a the header
-    ab_header header;
-    header.dir = 1;
-    header.typ = socket.config.socket_id;
-    header.from = socket.sender;
-    header.to = 0;
-    header.len = socket.bitdata.size() + socket.intdata.size() * 2 + socket.longdata.size() * 4 + socket.realdata.size() * 4 + 4;
-
-    // generate dataarray
-    char sendbuf[MAX_DATA_LEN];
-    ab_setHeader(sendbuf, sizeof(sendbuf), header);
-    // set socket data into it
-    ab_setSocket(sendbuf, sizeof(sendbuf), socket);
-
-    ab_setUIntVal(sendbuf, sizeof(sendbuf), header.len + 12, ab_calcCRC(sendbuf, header.len + 12));
-
-    sendRaw(sendbuf, header.len + 14);
+    auto encode = [&](char *data, size_t len) { return ab_encodeSocket(data, len, socket, sender, 0, destNad); };
+    return publish ? publishEncoded(socket.config.socket_id, encode) : sendEncoded(socket.config.socket_id, encode);
 }
-void abus_socket::sendRaw(char *data, size_t datalen)
+template <class Layout>
+ab_send_result abus_socket::sendSocket(uint8_t sock_id, const typename Layout::data &values, uint32_t sender, uint32_t destNad)
 {
-    ABSOCK_DBG_PRINTF(">  AB:    L%3d: ", datalen);
-    size_t pos = 0;
-    while (pos < datalen)
+    return sendLayout<Layout>(sock_id, values, sender, false, destNad);
+}
+template <class Layout>
+ab_send_result abus_socket::publish(uint8_t sock_id, const typename Layout::data &values, uint32_t sender)
+{
+    return sendLayout<Layout>(sock_id, values, sender, true, 0);
+}
+template <class Layout>
+ab_send_result abus_socket::sendLayout(uint8_t sock_id, const typename Layout::data &values, uint32_t sender, bool publish, uint32_t destNad)
+{
+    if (sock_id == 0)
     {
-        ABSOCK_DBG_PRINTF(":%02X", data[pos]);
-        pos++;
+        ABSOCK_ERR_PRINTLN(F("*AB: sendSocket()->ID missing!"));
+        return AB_SEND_INVALID;
+    }
+    if (sender == 0)
+        sender = m_ownNad;
+    if (sender == 0)
+    {
+        ABSOCK_ERR_PRINTLN(F("*AB: sendSocket()->sender missing!"));
+        return AB_SEND_INVALID;
+    }
+    auto encode = [&](char *data, size_t len) { return ab_encodeSocket<Layout>(data, len, sock_id, values, sender, 0, destNad); };
+    return publish ? publishEncoded(sock_id, encode) : sendEncoded(sock_id, encode);
+}
+template <class E>
+ab_send_result abus_socket::publishEncoded(uint8_t sock_id, E encode)
+{
+    ab_publisher *pub = NULL;
+#if ABSOCK_MAX_PUBLISHERS > 0
+    for (uint8_t i = 0; i < ABSOCK_MAX_PUBLISHERS; i++)
+    {
+        if (m_publishers[i].config.socket_id == sock_id)
+            pub = &m_publishers[i];
     }
-    Udp.beginPacket(m_BroadCastIp, m_localUdpPort);
-#if defined(ESP8266)
-    Udp.write(data, datalen);
-#elif defined(ESP32)
-    size_t i = 0;
-    while (i < datalen)
-        Udp.write((uint8_t)data[i++]);
 #endif
-    if (Udp.endPacket())
+    if (pub == NULL)
+        return sendEncoded(sock_id, encode);
+    char frame[MAX_DATA_LEN];
+    size_t len = encode(frame, sizeof(frame));
+    if (len == 0 || len != ab_getSocketLen(pub->config) + 14u)
     {
-        ABSOCK_DBG_PRINTLN(F(" sndOK"));
+        ABSOCK_ERR_PRINTLN(F("*AB: publish()->socket does not match the publisher!"));
+        return AB_SEND_INVALID;
+    }
+    if (pub->valid && !ab_socketChanged(frame, pub->frame.data, pub->config, pub->deadbands) &&
+        (pub->heartbeat == 0 || (uint32_t)(millis() - pub->last) < pub->heartbeat))
+    {
+        m_txStats.unchanged++;
+        return AB_SEND_UNCHANGED;
+    }
+    ab_send_result retval = sendEncoded(sock_id, [&](char *data, size_t datalen) {
+        if (datalen < len)
+            return (size_t)0;
+        memcpy(data, frame, len);
+        return len;
+    });
+    // the deadbands refer to the last frame which has been sent
+    if (retval == AB_SEND_OK || retval == AB_SEND_QUEUED)
+    {
+        memcpy(pub->frame.data, frame, len);
+        pub->frame.len = len;
+        pub->valid = true;
+        pub->last = millis();
+    }
+    return retval;
+}
+void abus_socket::heartbeatTx()
+{
+#if ABSOCK_MAX_PUBLISHERS > 0
+    uint32_t now = millis();
+    for (uint8_t i = 0; i < ABSOCK_MAX_PUBLISHERS; i++)
+    {
+        ab_publisher &pub = m_publishers[i];
+        if (pub.config.socket_id == 0 || !pub.valid || pub.heartbeat == 0 || (uint32_t)(now - pub.last) < pub.heartbeat)
+            continue;
+        ab_send_result retval = sendEncoded(pub.config.socket_id, [&](char *data, size_t datalen) {
+            if (datalen < pub.frame.len)
+                return (size_t)0;
+            memcpy(data, pub.frame.data, pub.frame.len);
+            return (size_t)pub.frame.len;
+        });
+        // a full queue is retried in the next call
+        if (retval != AB_SEND_OK && retval != AB_SEND_QUEUED)
+            break;
+        pub.last = now;
+    }
+#endif
+}
+uint8_t abus_socket::addPublisher(ab_socket_config config, uint16_t heartbeatMs, const ab_deadband *deadbands)
+{
+#if ABSOCK_MAX_PUBLISHERS > 0
+    if (config.socket_id == 0 || ab_getSocketLen(config) + 14u > MAX_DATA_LEN || ab_getSocketLen(config) == 4)
+    {
+        ABSOCK_ERR_PRINTLN(F("*AB: addPublisher()->invalid socket config!"));
+        return 0;
+    }
+    // an existing publisher of the socket id is replaced
+    uint8_t pos = ABSOCK_MAX_PUBLISHERS;
+    for (uint8_t i = 0; i < ABSOCK_MAX_PUBLISHERS; i++)
+    {
+        if (m_publishers[i].config.socket_id == config.socket_id)
+        {
+            pos = i;
+            break;
+        }
+        if (m_publishers[i].config.socket_id == 0 && pos == ABSOCK_MAX_PUBLISHERS)
+            pos = i;
+    }
+    if (pos < ABSOCK_MAX_PUBLISHERS)
+    {
+        ab_publisher &pub = m_publishers[pos];
+        pub.config = config;
+        pub.heartbeat = heartbeatMs;
+        pub.deadbands = deadbands;
+        pub.valid = false;
+        return pos + 1;
+    }
+#else
+    (void)config;
+    (void)heartbeatMs;
+    (void)deadbands;
+#endif
+    ABSOCK_ERR_PRINTLN(F("*AB: addPublisher()->no free publisher!"));
+    return 0;
+}
+bool abus_socket::removePublisher(uint8_t handle)
+{
+#if ABSOCK_MAX_PUBLISHERS > 0
+    if (handle == 0 || handle > ABSOCK_MAX_PUBLISHERS || m_publishers[handle - 1].config.socket_id == 0)
+        return false;
+    m_publishers[handle - 1].config.socket_id = 0;
+    m_publishers[handle - 1].valid = false;
+    return true;
+#else
+    (void)handle;
+    return false;
+#endif
+}
+template <class E>
+ab_send_result abus_socket::sendEncoded(uint8_t sock_id, E encode)
+{
+    ab_tx_slot *slot = NULL;
+#if ABSOCK_TX_SLOTS > 0
+    for (uint8_t i = 0; i < ABSOCK_TX_SLOTS; i++)
+    {
+        if (sock_id != 0 && m_txSlots[i].id == sock_id)
+            slot = &m_txSlots[i];
+    }
+    if (slot != NULL && (slot->pending || (uint32_t)(millis() - slot->last) < slot->interval))
+    {
+        // within the interval the frame waits in the slot, a waiting older frame is replaced
+        size_t len = encode(slot->frame.data, sizeof(slot->frame.data));
+        if (len == 0)
+        {
+            ABSOCK_ERR_PRINTLN(F("*AB: sendSocket()->socketdata too large!"));
+            return AB_SEND_INVALID;
+        }
+        if (slot->pending)
+            m_txStats.coalesced++;
+        slot->frame.len = len;
+        resolveNad(slot->frame.data, slot->frame.ip, slot->frame.port);
+        slot->pending = true;
+        return AB_SEND_QUEUED;
+    }
+#endif
+#if ABSOCK_TX_QUEUE_LEN > 0
+    // the frame is encoded in place into the next free queue entry, a full queue never blocks the caller
+    ab_tx_frame *frame = m_txQueue.writeSlot();
+    if (frame == NULL)
+    {
+        m_txStats.dropped++;
+        traceTx(AB_TRACE_TX_DROP, sock_id, NULL, 0, AB_SEND_QUEUE_FULL);
+        ABSOCK_ERR_PRINTLN(F("*AB: sendSocket()->transmit queue full!"));
+        return AB_SEND_QUEUE_FULL;
+    }
+    size_t len = encode(frame->data, sizeof(frame->data));
+    if (len == 0)
+    {
+        ABSOCK_ERR_PRINTLN(F("*AB: sendSocket()->socketdata too large!"));
+        return AB_SEND_INVALID;
+    }
+    commitTxFrame(len);
+    if (slot != NULL)
+        slot->last = millis();
+    return AB_SEND_QUEUED;
+#else
+    if (!takeTxToken())
+    {
+        m_txStats.dropped++;
+        traceTx(AB_TRACE_TX_DROP, sock_id, NULL, 0, AB_SEND_RATE_LIMITED);
+        return AB_SEND_RATE_LIMITED;
+    }
+    // encode straight into the transmit buffer of the transport (no frame buffer of its own)
+    size_t len = encode(m_transport->txBuffer(), m_transport->txBufferSize());
+    if (len == 0)
+    {
+        ABSOCK_ERR_PRINTLN(F("*AB: sendSocket()->socketdata too large!"));
+        return AB_SEND_INVALID;
+    }
+    if (slot != NULL)
+        slot->last = millis();
+    uint32_t ip;
+    uint16_t port;
+    resolveNad(m_transport->txBuffer(), ip, port);
+    return sendFrame(m_transport->txBuffer(), len, ip, port);
+#endif
+}
+void abus_socket::commitTxFrame(size_t len)
+{
+#if ABSOCK_TX_QUEUE_LEN > 0
+    ab_tx_frame *frame = m_txQueue.writeSlot();
+    frame->len = len;
+    resolveNad(frame->data, frame->ip, frame->port);
+    m_txQueue.commit();
+    m_txStats.queued++;
+    uint16_t queued = m_txQueue.size();
+    if (queued > m_txStats.queue_max)
+        m_txStats.queue_max = queued;
+#ifdef AB_TASK_SUPPORTED
+    if (m_txTask.running())
+        m_txTask.notify();
+#endif
+#else
+    (void)len;
+#endif
+}
+void abus_socket::scheduleTx()
+{
+#if ABSOCK_TX_SLOTS > 0
+    uint32_t now = millis();
+    for (uint8_t i = 0; i < ABSOCK_TX_SLOTS; i++)
+    {
+        ab_tx_slot &slot = m_txSlots[i];
+        if (!slot.pending || (uint32_t)(now - slot.last) < slot.interval)
+            continue;
+#if ABSOCK_TX_QUEUE_LEN > 0
+        ab_tx_frame *frame = m_txQueue.writeSlot();
+        // the frame keeps waiting if the queue is full
+        if (frame == NULL)
+            break;
+        memcpy(frame->data, slot.frame.data, slot.frame.len);
+        commitTxFrame(slot.frame.len);
+#else
+        if (!takeTxToken())
+            break;
+        sendFrame(slot.frame.data, slot.frame.len, slot.frame.ip, slot.frame.port);
+#endif
+        slot.pending = false;
+        slot.last = now;
+    }
+#endif
+}
+bool abus_socket::takeTxToken()
+{
+    if (m_txRateCost.load(std::memory_order_relaxed) == 0)
+        return true;
+#ifdef AB_TASK_SUPPORTED
+    ab_lock lock(m_txRateLock);
+#endif
+    uint32_t cost = m_txRateCost.load(std::memory_order_relaxed);
+    uint32_t now = micros();
+    uint32_t maxCredit = cost * m_txRateBurst;
+    uint32_t elapsed = now - m_txRateLast;
+    m_txRateLast = now;
+    // the credit is limited to the burst size
+    if (elapsed > maxCredit)
+        elapsed = maxCredit;
+    m_txRateCredit += elapsed;
+    if (m_txRateCredit > maxCredit)
+        m_txRateCredit = maxCredit;
+    if (m_txRateCredit < cost)
+        return false;
+    m_txRateCredit -= cost;
+    return true;
+}
+bool abus_socket::getNadAddress(uint32_t nad, IPAddress &ip, uint16_t &port)
+{
+#if ABSOCK_NAD_CACHE_LEN > 0
+    uint32_t addr;
+    if (m_nadCache.lookup(nad, addr, port))
+    {
+        ip = IPAddress(addr);
+        return true;
     }
+#else
+    (void)nad;
+    (void)ip;
+    (void)port;
+#endif
+    return false;
+}
+void abus_socket::forgetNad(uint32_t nad)
+{
+#if ABSOCK_NAD_CACHE_LEN > 0
+    if (nad == 0)
+        m_nadCache.clear();
     else
+        m_nadCache.forget(nad);
+#else
+    (void)nad;
+#endif
+}
+bool abus_socket::setSendInterval(uint8_t sock_id, uint16_t minIntervalMs)
+{
+#if ABSOCK_TX_SLOTS > 0
+    if (sock_id == 0)
+        return false;
+    ab_tx_slot *slot = NULL;
+    for (uint8_t i = 0; i < ABSOCK_TX_SLOTS; i++)
+    {
+        if (m_txSlots[i].id == sock_id)
+            slot = &m_txSlots[i];
+        else if (slot == NULL && m_txSlots[i].id == 0 && minIntervalMs > 0)
+            slot = &m_txSlots[i];
+    }
+    if (slot == NULL)
+    {
+        if (minIntervalMs == 0)
+            return true;
+        ABSOCK_ERR_PRINTLN(F("*AB: setSendInterval()->no free slot (ABSOCK_TX_SLOTS)!"));
+        return false;
+    }
+    if (minIntervalMs == 0)
+    {
+        slot->id = 0;
+        slot->pending = false;
+        return true;
+    }
+    if (slot->id != sock_id)
+    {
+        slot->id = sock_id;
+        slot->pending = false;
+        slot->last = millis() - minIntervalMs;
+    }
+    slot->interval = minIntervalMs;
+    return true;
+#else
+    (void)sock_id;
+    if (minIntervalMs == 0)
+        return true;
+    ABSOCK_ERR_PRINTLN(F("*AB: setSendInterval()->no coalescing slots compiled in (ABSOCK_TX_SLOTS 0)!"));
+    return false;
+#endif
+}
+void abus_socket::setSendRate(uint16_t maxPacketsPerSecond, uint8_t burst)
+{
+#ifdef AB_TASK_SUPPORTED
+    ab_lock lock(m_txRateLock);
+#endif
+    uint32_t cost = maxPacketsPerSecond > 0 ? 1000000u / maxPacketsPerSecond : 0;
+    m_txRateBurst = burst > 0 ? burst : 1;
+    // the bucket starts full
+    m_txRateCredit = cost * m_txRateBurst;
+    m_txRateLast = micros();
+    m_txRateCost.store(cost, std::memory_order_relaxed);
+}
+void abus_socket::resolveNad(const char *data, uint32_t &ip, uint16_t &port)
+{
+    ip = 0;
+    port = 0;
+#if ABSOCK_NAD_CACHE_LEN > 0
+    // destination NAD of the frame header (to)
+    uint32_t dest = ab_loadU32(data + 8);
+    if (dest != 0 && !m_nadCache.lookup(dest, ip, port))
+    {
+        ABSOCK_DBG_PRINTF("*AB: sendSocket()->NAD %lu unknown, broadcast\n", (unsigned long)dest);
+    }
+#else
+    (void)data;
+#endif
+}
+void abus_socket::traceTx(uint8_t event, uint8_t sock_id, const char *data, size_t datalen, ab_send_result result)
+{
+    ab_trace *trace = m_trace.load(std::memory_order_acquire);
+    if (trace == NULL)
+        return;
+    // destination NAD of the frame header (to)
+    uint32_t dest = 0;
+    if (data != NULL && datalen >= 12)
+        dest = ab_loadU32(data + 8);
+    trace->record(event, sock_id, dest, (uint16_t)datalen, result);
+}
+ab_send_result abus_socket::sendFrame(const char *data, size_t datalen, uint32_t ip, uint16_t port)
+{
+    ABSOCK_DBG_PRINTF(">  AB:    L%3d: ", (int)datalen);
+#ifdef ABSOCK_DEBUG_FRAMES
+    for (size_t pos = 0; pos < datalen; pos++)
+        ABSOCK_DBG_PRINTF(":%02X", (uint8_t)data[pos]);
+#endif
+    // frames to a learned NAD go directly to its address
+    IPAddress destIp = m_BroadCastIp;
+    uint16_t destPort = m_localUdpPort;
+    if (ip != 0)
+    {
+        destIp = IPAddress(ip);
+        destPort = port;
+    }
+    ab_capture_sink *capture = m_capture.load(std::memory_order_acquire);
+    if (capture != NULL)
+    {
+        ab_capture_record rec;
+        rec.time = micros();
+        rec.len = (uint16_t)datalen;
+        rec.caplen = (uint16_t)datalen;
+        rec.dir = AB_CAPTURE_TX;
+        capture->write(rec, data);
+    }
+    // a frame in the transmit buffer of the transport is handed over with sendTxBuffer(), the transport decides about copying it
+    bool ok = data == m_transport->txBuffer() ? m_transport->sendTxBuffer(destIp, destPort, datalen)
+                                              : m_transport->send(destIp, destPort, data, datalen);
+    if (ok)
+    {
+        ab_task_counters::count(m_taskStats.tx_sent);
+        if (ip != 0)
+            ab_task_counters::count(m_taskStats.tx_unicast);
+        traceTx(AB_TRACE_TX, datalen > 13 ? (uint8_t)data[13] : 0, data, datalen, AB_SEND_OK);
+        ABSOCK_DBG_PRINTLN(F(" sndOK"));
+        return AB_SEND_OK;
+    }
+    ab_task_counters::count(m_taskStats.tx_failed);
+    traceTx(AB_TRACE_TX, datalen > 13 ? (uint8_t)data[13] : 0, data, datalen, AB_SEND_FAILED);
+    ABSOCK_ERR_PRINTLN(F("*AB: send failed!"));
+    return AB_SEND_FAILED;
+}
+ab_send_result abus_socket::sendRaw(char *data, size_t datalen)
+{
+#ifdef AB_TASK_SUPPORTED
+    // sendFrame() and its counters belong to the transmit task while it is running
+    if (m_txTask.running())
+        return queueRaw(data, datalen);
+#endif
+    // raw frames with a destination NAD in the header are sent as unicast as well
+    uint32_t ip = 0;
+    uint16_t port = 0;
+    if (datalen >= 12)
+        resolveNad(data, ip, port);
+    return sendFrame(data, datalen, ip, port);
+}
+ab_send_result abus_socket::queueRaw(const char *data, size_t datalen)
+{
+    if (data == NULL || datalen < 18 || datalen > MAX_DATA_LEN)
+        return AB_SEND_INVALID;
+    // socket id 0 never matches a coalescing slot
+    return sendEncoded(0, [&](char *buf, size_t len) -> size_t {
+        if (datalen > len)
+            return 0;
+        memcpy(buf, data, datalen);
+        return datalen;
+    });
+}
+void abus_socket::setFrameHook(ab_frame_hook hook, void *ctx)
+{
+    m_frameHook[0] = hook;
+    m_frameHookCtx[0] = ctx;
+}
+bool abus_socket::addFrameHook(ab_frame_hook hook, void *ctx)
+{
+    for (uint8_t i = 1; i < ABSOCK_MAX_FRAME_HOOKS && hook != NULL; i++)
+    {
+        if (m_frameHook[i] != NULL)
+            continue;
+        m_frameHook[i] = hook;
+        m_frameHookCtx[i] = ctx;
+        return true;
+    }
+    return false;
+}
+bool abus_socket::removeFrameHook(ab_frame_hook hook, void *ctx)
+{
+    for (uint8_t i = 1; i < ABSOCK_MAX_FRAME_HOOKS; i++)
+    {
+        if (m_frameHook[i] != hook || m_frameHookCtx[i] != ctx || hook == NULL)
+            continue;
+        m_frameHook[i] = NULL;
+        m_frameHookCtx[i] = NULL;
+        return true;
+    }
+    return false;
+}
+uint32_t abus_socket::getOwnNad() const
+{
+    return m_ownNad;
+}
+void abus_socket::setLogLevel(ab_log_level level)
+{
+    m_logLevel = level;
+}
+ab_log_level abus_socket::logLevel() const
+{
+    return (ab_log_level)m_logLevel;
+}
+void abus_socket::setTrace(ab_trace *trace)
+{
+    m_trace.store(trace, std::memory_order_release);
+}
+void abus_socket::setCapture(ab_capture_sink *capture)
+{
+    m_capture.store(capture, std::memory_order_release);
+}
+void abus_socket::setMirror(ab_mirror_target *mirror)
+{
+    m_mirror = mirror;
+}
+void abus_socket::setDedup(ab_dedup *dedup)
+{
+    m_dedup = dedup;
+}
+uint16_t abus_socket::flushQueue(uint16_t maxFrames)
+{
+    uint16_t retval = 0;
+#if ABSOCK_TX_QUEUE_LEN > 0
+    ab_tx_frame *frame;
+    while ((maxFrames == 0 || retval < maxFrames) && (frame = m_txQueue.readSlot()) != NULL)
+    {
+        // frames above the global rate stay in the queue
+        if (!takeTxToken())
+            break;
+        sendFrame(frame->data, frame->len, frame->ip, frame->port);
+        m_txQueue.release();
+        retval++;
+    }
+#else
+    (void)maxFrames;
+#endif
+    return retval;
+}
+uint16_t abus_socket::flush(uint16_t maxFrames)
+{
+    heartbeatTx();
+    scheduleTx();
+#ifdef AB_TASK_SUPPORTED
+    // the transmit task is the only consumer of the queue while it is running
+    if (m_txTask.running())
+        return 0;
+#endif
+    return flushQueue(maxFrames);
+}
+uint16_t abus_socket::txQueueLength() const
+{
+#if ABSOCK_TX_QUEUE_LEN > 0
+    return m_txQueue.size();
+#else
+    return 0;
+#endif
+}
+ab_tx_stats abus_socket::getTxStats() const
+{
+    ab_rx_stats rx;
+    ab_tx_stats retval = m_txStats;
+    m_taskStats.copyTo(rx, retval);
+    return retval;
+}
+ab_stats abus_socket::getStats() const
+{
+    ab_stats retval;
+    retval.rx = m_rxStats;
+    retval.tx = m_txStats;
+    m_taskStats.copyTo(retval.rx, retval.tx);
+    retval.callback = m_cbTime;
+    retval.loop = m_loopTime;
+    return retval;
+}
+bool abus_socket::getSocketStats(uint8_t sock_id, uint32_t &hits, uint32_t &misses) const
+{
+    hits = 0;
+    misses = 0;
+#if ABSOCK_ID_STATS
+    uint8_t pos = cb_head[sock_id];
+    if (pos == ABSOCK_CB_NONE)
+        return false;
+    hits = m_idHits[pos];
+    misses = m_idMisses[pos];
+    return true;
+#else
+    (void)sock_id;
+    return false;
+#endif
+}
+void abus_socket::resetStats()
+{
+    m_rxStats = ab_rx_stats();
+    m_txStats = ab_tx_stats();
+    m_taskStats.reset();
+    m_cbTime = ab_histogram();
+    m_loopTime = ab_histogram();
+#if ABSOCK_ID_STATS
+    memset(m_idHits, 0, sizeof(m_idHits));
+    memset(m_idMisses, 0, sizeof(m_idMisses));
+#endif
+}
+#ifdef AB_TASK_SUPPORTED
+bool abus_socket::startTxTask(uint32_t stackSize, uint8_t priority, int core)
+{
+    return m_txTask.start(txTaskFunction, this, "abus_tx", stackSize, priority, core);
+}
+void abus_socket::stopTxTask()
+{
+    m_txTask.stop();
+}
+void abus_socket::txTaskFunction(void *arg)
+{
+    abus_socket *self = static_cast<abus_socket *>(arg);
+    // the timeout only limits the delay of a missed notification
+    while (self->m_txTask.wait(10))
+        self->flushQueue(0);
+    self->flushQueue(0);
+}
+#endif
+#ifdef ABSOCK_RX_TASK
+bool abus_socket::startRxTask(uint32_t stackSize, uint8_t priority, int core)
+{
+    if (m_rxTask.running())
+        return false;
+    // one receive buffer per queue entry, allocated at the first start
+    if (m_rxArena == NULL)
+    {
+        m_rxArena = new (std::nothrow) char[(size_t)ABSOCK_RX_QUEUE_LEN * m_rxBufSize];
+        if (m_rxArena == NULL)
+        {
+            ABSOCK_ERR_PRINTLN(F("*AB: startRxTask()->no memory for the receive queue!"));
+            return false;
+        }
+    }
+    // a datagram already fetched by loop() would be discarded by the first parsePacket() of the task
+    if (m_pendingLen > 0)
     {
-        ABSOCK_ERR_PRINTLN(F("*AB: send failed!"));
+        int len = m_pendingLen;
+        m_pendingLen = 0;
+        handlePacket(len, m_pendingIp, m_pendingPort);
     }
+    return m_rxTask.start(rxTaskFunction, this, "abus_rx", stackSize, priority, core);
 }
+void abus_socket::stopRxTask()
+{
+    m_rxTask.stop();
+}
+uint16_t abus_socket::rxQueueLength() const
+{
+    return m_rxQueue.size();
+}
+void abus_socket::rxTaskFunction(void *arg)
+{
+    abus_socket *self = static_cast<abus_socket *>(arg);
+    while (self->m_rxTask.running())
+    {
+        // the sender is fetched together with the datagram, a concurrent send may change the address of the driver
+        uint32_t ip;
+        uint16_t port;
+        int len = self->m_transport->parsePacketFrom(ip, port);
+        // the timeout only limits the reaction time to stopRxTask()
+        if (len <= 0)
+            self->m_transport->waitPacket(10);
+        else
+            self->queuePacket(len, ip, port);
+    }
+}
+void abus_socket::queuePacket(int len, uint32_t ip, uint16_t port)
+{
+    ab_rx_frame *frame = m_rxQueue.writeSlot();
+    if (frame == NULL)
+    {
+        // the unread datagram is discarded by the next parsePacket()
+        ab_task_counters::count(m_taskStats.rx_frames);
+        ab_task_counters::count(m_taskStats.rx_bytes, len);
+        ab_task_counters::count(m_taskStats.rx_overflow);
+        return;
+    }
+    // the queue entries are used in order, so the amount of queued frames selects the buffer of the entry
+    frame->data = m_rxArena + (size_t)(m_rxSlot & (ABSOCK_RX_QUEUE_LEN - 1)) * m_rxBufSize;
+    if (readPacket(frame->data, len) != AB_PACKET_OK)
+        return;
+    frame->len = (uint16_t)len;
+    frame->ip = ip;
+    frame->port = port;
+    m_rxQueue.commit();
+    m_rxSlot++;
+}
+#endif
 uint8_t abus_socket::setSocketCallback(ab_socket_config config, SubscribeCallbackAbSocket cbFunction)
 {
+    ab_socket_callback fct;
+    fct.socket = cbFunction;
+    return addCallback(config, AB_CB_SOCKET, fct);
+}
+uint8_t abus_socket::setSocketCallback(ab_socket_config config, SubscribeCallbackAbFixedSocket cbFunction)
+{
+    if (!ab_fitsFixedSocket(config))
+    {
+        ABSOCK_ERR_PRINTLN(F("*AB: setSocketCallback()->too many tags for ab_fixed_socket!"));
+        return 0;
+    }
+    ab_socket_callback fct;
+    fct.fixed = cbFunction;
+    return addCallback(config, AB_CB_FIXED, fct);
+}
+uint8_t abus_socket::setSocketCallback(ab_socket_config config, SubscribeCallbackAbSocketView cbFunction)
+{
+    ab_socket_callback fct;
+    fct.view = cbFunction;
+    return addCallback(config, AB_CB_VIEW, fct);
+}
+uint8_t abus_socket::addCallback(const ab_socket_config &config, uint8_t kind, ab_socket_callback cbFunction)
+{
+    if ((kind == AB_CB_SOCKET && cbFunction.socket == NULL) || (kind == AB_CB_FIXED && cbFunction.fixed == NULL) ||
+        (kind == AB_CB_TYPED && cbFunction.typed == NULL) || (kind == AB_CB_VIEW && cbFunction.view == NULL))
+    {
+        ABSOCK_ERR_PRINTLN(F("*AB: setSocketCallback()->no callback function!"));
+        return 0;
+    }
     uint8_t pos = 1;
     while (pos <= ABSOCK_MAX_SOCKETS)
     {
@@ -380,6 +2200,22 @@ uint8_t abus_socket::setSocketCallback(ab_socket_config config, SubscribeCallbac
             cb_id[pos - 1] = pos;
             cb_socketInfo[pos - 1] = config;
             cb_fct[pos - 1] = cbFunction;
+            cb_kind[pos - 1] = kind;
+            cb_len[pos - 1] = ab_getSocketLen(config);
+            cb_next[pos - 1] = ABSOCK_CB_NONE;
+#if ABSOCK_ID_STATS
+            // the first callback of a socket id starts its counters
+            if (cb_head[config.socket_id] == ABSOCK_CB_NONE)
+            {
+                m_idHits[pos - 1] = 0;
+                m_idMisses[pos - 1] = 0;
+            }
+#endif
+            // append to the end of the socket id chain to keep the registration order
+            uint8_t *link = &cb_head[config.socket_id];
+            while (*link != ABSOCK_CB_NONE)
+                link = &cb_next[*link];
+            *link = pos - 1;
             ABSOCK_DBG_PRINTF("*AB: subscribeSocket: pos=%d, id=%d, bits=%d, ints=%d, longs=%d, reals=%d\n", pos - 1, config.socket_id, config.bitcount, config.intcount, config.longcount, config.realcount);
             return pos;
         }
@@ -387,6 +2223,44 @@ uint8_t abus_socket::setSocketCallback(ab_socket_config config, SubscribeCallbac
     }
     return 0;
 }
+uint8_t abus_socket::setSocketCallbacks(const ab_socket_config *configs, uint8_t count, SubscribeCallbackAbSocketView cbFunction)
+{
+    uint8_t free = 0;
+    for (uint8_t pos = 0; pos < ABSOCK_MAX_SOCKETS; pos++)
+        free += cb_id[pos] == 0;
+    if (count == 0 || count > free || cbFunction == NULL)
+        return 0;
+    // last entry of every socket id chain, so appending does not walk the chains again
+    uint8_t tail[256];
+    memset(tail, ABSOCK_CB_NONE, sizeof(tail));
+    for (uint8_t pos = 0; pos < ABSOCK_MAX_SOCKETS; pos++)
+    {
+        if (cb_id[pos] != 0 && cb_next[pos] == ABSOCK_CB_NONE)
+            tail[cb_socketInfo[pos].socket_id] = pos;
+    }
+    ab_socket_callback fct;
+    fct.view = cbFunction;
+    uint8_t pos = 0;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        while (cb_id[pos] != 0)
+            pos++;
+        const ab_socket_config &config = configs[i];
+        cb_id[pos] = pos + 1;
+        cb_socketInfo[pos] = config;
+        cb_fct[pos] = fct;
+        cb_kind[pos] = AB_CB_VIEW;
+        cb_len[pos] = ab_getSocketLen(config);
+        cb_next[pos] = ABSOCK_CB_NONE;
+        if (tail[config.socket_id] == ABSOCK_CB_NONE)
+            cb_head[config.socket_id] = pos;
+        else
+            cb_next[tail[config.socket_id]] = pos;
+        tail[config.socket_id] = pos;
+    }
+    ABSOCK_DBG_PRINTF("*AB: subscribeSockets: count=%d\n", count);
+    return count;
+}
 uint8_t abus_socket::setSocketCallback(uint8_t sock_id, uint8_t bitcount, uint8_t intcount, uint8_t longcount, uint8_t realcount, SubscribeCallbackAbSocket cbFunction)
 {
     ab_socket_config config;
@@ -397,6 +2271,36 @@ uint8_t abus_socket::setSocketCallback(uint8_t sock_id, uint8_t bitcount, uint8_
     config.realcount = realcount;
     return setSocketCallback(config, cbFunction);
 }
+uint8_t abus_socket::setSocketCallback(uint8_t sock_id, uint8_t bitcount, uint8_t intcount, uint8_t longcount, uint8_t realcount, SubscribeCallbackAbFixedSocket cbFunction)
+{
+    ab_socket_config config;
+    config.socket_id = sock_id;
+    config.bitcount = bitcount;
+    config.intcount = intcount;
+    config.longcount = longcount;
+    config.realcount = realcount;
+    return setSocketCallback(config, cbFunction);
+}
+uint8_t abus_socket::setSocketCallback(uint8_t sock_id, uint8_t bitcount, uint8_t intcount, uint8_t longcount, uint8_t realcount, SubscribeCallbackAbSocketView cbFunction)
+{
+    ab_socket_config config;
+    config.socket_id = sock_id;
+    config.bitcount = bitcount;
+    config.intcount = intcount;
+    config.longcount = longcount;
+    config.realcount = realcount;
+    return setSocketCallback(config, cbFunction);
+}
+template <class Layout>
+uint8_t abus_socket::setSocketCallback(uint8_t sock_id, typename Layout::callback cbFunction)
+{
+    ab_socket_callback fct;
+    fct.typed = reinterpret_cast<void (*)()>(cbFunction);
+    uint8_t handle = addCallback(Layout::config(sock_id), AB_CB_TYPED, fct);
+    if (handle > 0)
+        cb_thunk[handle - 1] = &ab_typedSocketThunk<Layout>;
+    return handle;
+}
 bool abus_socket::removeSocketCallback(uint8_t handle)
 {
     if (handle == 0 || handle > ABSOCK_MAX_SOCKETS)
@@ -404,15 +2308,55 @@ bool abus_socket::removeSocketCallback(uint8_t handle)
     uint8_t pos = 1;
     while (pos <= ABSOCK_MAX_SOCKETS)
     {
-        if(cb_id[pos - 1] == handle)
+        if(cb_id[pos - 1] == handle && cb_kind[pos - 1] != AB_CB_REMOVED)
         {
-            cb_id[pos - 1] = 0;
-            cb_fct[pos - 1] = NULL;
+            if (m_dispatchDepth > 0)
+            {
+                // called from a callback: the dispatch loop still walks the chain, so the entry
+                // (and its handle) stays linked until the pass is done but is not called again
+                cb_kind[pos - 1] = AB_CB_REMOVED;
+                m_cbRemoved = true;
+            }
+            else
+                unlinkCallback(pos - 1);
             ABSOCK_DBG_PRINTF("*AB: unsubscribeSocket: handle=%1d\n", handle);
             return true;
         }
+        pos++;
     }
     return false;
 }
+void abus_socket::unlinkCallback(uint8_t pos)
+{
+    uint8_t *link = &cb_head[cb_socketInfo[pos].socket_id];
+    while (*link != ABSOCK_CB_NONE && *link != pos)
+        link = &cb_next[*link];
+    if (*link == pos)
+    {
+        *link = cb_next[pos];
+#if ABSOCK_ID_STATS
+        // the counters of the socket id move on with the head of the chain
+        uint8_t head = cb_head[cb_socketInfo[pos].socket_id];
+        if (head == cb_next[pos] && head != ABSOCK_CB_NONE)
+        {
+            m_idHits[head] = m_idHits[pos];
+            m_idMisses[head] = m_idMisses[pos];
+        }
+#endif
+    }
+    cb_id[pos] = 0;
+    cb_next[pos] = ABSOCK_CB_NONE;
+}
+void abus_socket::initCallbacks()
+{
+#if ABSOCK_ID_STATS
+    memset(m_idHits, 0, sizeof(m_idHits));
+    memset(m_idMisses, 0, sizeof(m_idMisses));
+#endif
+    memset(cb_id, 0, sizeof(cb_id));
+    m_cbRemoved = false;
+    memset(cb_next, ABSOCK_CB_NONE, sizeof(cb_next));
+    memset(cb_head, ABSOCK_CB_NONE, sizeof(cb_head));
+}
 
 #endif
\ No newline at end of file
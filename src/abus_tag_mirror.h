@@ -0,0 +1,336 @@
+/**
+ * abus_tag_mirror.h
+ * Purpose: latest tag values of received sockets in flat arrays, updated by abus_socket::loop() and
+ * readable from other tasks / threads without mutex (one seqlock per socket)
+
+ * @author Daniel Gangl
+ */
+#ifndef _ABUS_TAG_MIRROR_H_
+#define _ABUS_TAG_MIRROR_H_
+
+#include <abus_helper.h>
+#include <atomic>
+
+// end marker of a socket chain in the mirror
+#define AB_MIRROR_NONE 0xFF
+
+/**
+ * receiver of the socket frames of abus_socket (see abus_socket::setMirror())
+ */
+class ab_mirror_target
+{
+public:
+    virtual ~ab_mirror_target() {}
+    /**
+     * store the tags of a checked socket frame
+     * @param frame checked frame
+     * @param len length of the frame
+     * @param header header of the frame
+     * @return true = at least one mirrored socket updated
+     */
+    virtual bool update(const char *frame, size_t len, const ab_header &header) = 0;
+};
+
+/**
+ * tag mirror with fixed storage: every registered socket (NAD, socket id, layout) gets a range in the
+ * flat bit, int, long and real arrays which loop() overwrites with the values of each received frame
+ * the writer is the task which calls abus_socket::loop(), add() has to be called from there too;
+ * any other task can read the values at the same time, a sequence counter per socket (seqlock) makes
+ * the reader retry while a frame is written, so a read never returns a mix of two frames
+ * usage:
+ *   ab_tag_mirror<8, 16, 32, 16, 32> mirror;
+ *   uint8_t plc = mirror.add(1234, 7, 0, 0, 0, 4);
+ *   abSock.setMirror(&mirror);
+ *   ... float_t value; if (mirror.getReal(plc, 3, value)) ...
+ * @param SOCKETS maximum amount of mirrored sockets (up to 254)
+ * @param BITS amount of bit tags of all sockets
+ * @param INTS amount of int tags of all sockets
+ * @param LONGS amount of long tags of all sockets
+ * @param REALS amount of real tags of all sockets
+ */
+template <uint8_t SOCKETS, uint16_t BITS, uint16_t INTS, uint16_t LONGS, uint16_t REALS>
+class ab_tag_mirror : public ab_mirror_target
+{
+    static_assert(SOCKETS > 0 && SOCKETS < AB_MIRROR_NONE, "ab_tag_mirror supports 1 to 254 sockets");
+
+public:
+    ab_tag_mirror()
+    {
+        memset(m_head, AB_MIRROR_NONE, sizeof(m_head));
+    }
+    /**
+     * add a socket to the mirror (from the task which calls abus_socket::loop())
+     * @param nad NAD of the sender (0 = any sender, the values of the last frame are kept)
+     * @param config socket id and amount of bit, int, long and real tags
+     * @return handle of the socket (0 = error, no space left)
+     */
+    uint8_t add(uint32_t nad, const ab_socket_config &config)
+    {
+        uint8_t pos = m_count.load(std::memory_order_relaxed);
+        if (config.socket_id == 0 || pos >= SOCKETS || find(nad, config.socket_id) != 0 ||
+            m_bitUsed + config.bitcount > BITS || m_intUsed + config.intcount > INTS ||
+            m_longUsed + config.longcount > LONGS || m_realUsed + config.realcount > REALS)
+            return 0;
+        m_nad[pos] = nad;
+        m_config[pos] = config;
+        m_len[pos] = ab_getSocketLen(config);
+        m_bitPos[pos] = m_bitUsed;
+        m_intPos[pos] = m_intUsed;
+        m_longPos[pos] = m_longUsed;
+        m_realPos[pos] = m_realUsed;
+        m_bitUsed += config.bitcount;
+        m_intUsed += config.intcount;
+        m_longUsed += config.longcount;
+        m_realUsed += config.realcount;
+        m_seq[pos].store(0, std::memory_order_relaxed);
+        m_next[pos] = m_head[config.socket_id];
+        m_head[config.socket_id] = pos;
+        // readers only see completely registered sockets
+        m_count.store(pos + 1, std::memory_order_release);
+        return pos + 1;
+    }
+    /**
+     * add a socket to the mirror (from the task which calls abus_socket::loop())
+     * @param nad NAD of the sender (0 = any sender)
+     * @param sock_id socket id
+     * @param bitcount amount of bit tags
+     * @param intcount amount of int tags
+     * @param longcount amount of long tags
+     * @param realcount amount of real tags
+     * @return handle of the socket (0 = error, no space left)
+     */
+    uint8_t add(uint32_t nad, uint8_t sock_id, uint8_t bitcount, uint8_t intcount, uint8_t longcount, uint8_t realcount)
+    {
+        ab_socket_config config;
+        config.socket_id = sock_id;
+        config.bitcount = bitcount;
+        config.intcount = intcount;
+        config.longcount = longcount;
+        config.realcount = realcount;
+        return add(nad, config);
+    }
+    /**
+     * find a registered socket
+     * @param nad NAD of the sender as given to add()
+     * @param sock_id socket id
+     * @return handle of the socket (0 = not registered)
+     */
+    uint8_t find(uint32_t nad, uint8_t sock_id) const
+    {
+        uint8_t count = m_count.load(std::memory_order_acquire);
+        for (uint8_t i = 0; i < count; i++)
+        {
+            if (m_nad[i] == nad && m_config[i].socket_id == sock_id)
+                return i + 1;
+        }
+        return 0;
+    }
+    /**
+     * @param handle handle of the socket
+     * @return amount of received frames of the socket (0 = nothing received yet), changes with every update
+     */
+    uint32_t version(uint8_t handle) const
+    {
+        if (!valid(handle))
+            return 0;
+        return m_seq[handle - 1].load(std::memory_order_acquire) / 2;
+    }
+    /**
+     * read a bit tag
+     * @param handle handle of the socket
+     * @param pos index of the bit tag
+     * @param value receives the tag value
+     * @param version receives the version of the value (optional)
+     * @return true = value valid, false = unknown tag or nothing received yet
+     */
+    bool getBit(uint8_t handle, uint8_t pos, bool &value, uint32_t *version = NULL) const
+    {
+        uint8_t raw;
+        if (!valid(handle) || pos >= m_config[handle - 1].bitcount || !load(handle - 1, m_bits + m_bitPos[handle - 1] + pos, raw, version))
+            return false;
+        value = raw > 0;
+        return true;
+    }
+    /**
+     * read an int tag
+     * @param handle handle of the socket
+     * @param pos index of the int tag
+     * @param value receives the tag value
+     * @param version receives the version of the value (optional)
+     * @return true = value valid, false = unknown tag or nothing received yet
+     */
+    bool getInt(uint8_t handle, uint8_t pos, int16_t &value, uint32_t *version = NULL) const
+    {
+        return valid(handle) && pos < m_config[handle - 1].intcount && load(handle - 1, m_ints + m_intPos[handle - 1] + pos, value, version);
+    }
+    /**
+     * read a long tag
+     * @param handle handle of the socket
+     * @param pos index of the long tag
+     * @param value receives the tag value
+     * @param version receives the version of the value (optional)
+     * @return true = value valid, false = unknown tag or nothing received yet
+     */
+    bool getLong(uint8_t handle, uint8_t pos, int32_t &value, uint32_t *version = NULL) const
+    {
+        return valid(handle) && pos < m_config[handle - 1].longcount && load(handle - 1, m_longs + m_longPos[handle - 1] + pos, value, version);
+    }
+    /**
+     * read a real tag
+     * @param handle handle of the socket
+     * @param pos index of the real tag
+     * @param value receives the tag value
+     * @param version receives the version of the value (optional)
+     * @return true = value valid, false = unknown tag or nothing received yet
+     */
+    bool getReal(uint8_t handle, uint8_t pos, float_t &value, uint32_t *version = NULL) const
+    {
+        return valid(handle) && pos < m_config[handle - 1].realcount && load(handle - 1, m_reals + m_realPos[handle - 1] + pos, value, version);
+    }
+    /**
+     * read all tags of a socket from the same frame
+     * @param handle handle of the socket
+     * @param socket receives the tags, the sender NAD and the configuration
+     * @param version receives the version of the values (optional)
+     * @return true = values valid, false = unknown socket or nothing received yet
+     */
+    bool read(uint8_t handle, ab_fixed_socket &socket, uint32_t *version = NULL) const
+    {
+        if (!valid(handle))
+            return false;
+        uint8_t i = handle - 1;
+        const ab_socket_config &conf = m_config[i];
+        for (uint16_t tries = 0;; tries++)
+        {
+            uint32_t seq = m_seq[i].load(std::memory_order_acquire);
+            if (seq == 0)
+                return false;
+            if ((seq & 1) == 0)
+            {
+                // the sections share one area, they are sized once before they are filled
+                socket.bitdata.clear();
+                socket.intdata.clear();
+                socket.longdata.clear();
+                socket.realdata.clear();
+                socket.longdata.resize(conf.longcount);
+                socket.realdata.resize(conf.realcount);
+                socket.intdata.resize(conf.intcount);
+                socket.bitdata.resize(conf.bitcount);
+                for (uint8_t j = 0; j < conf.bitcount; j++)
+                    socket.bitdata[j] = m_bits[m_bitPos[i] + j].load(std::memory_order_relaxed);
+                for (uint8_t j = 0; j < conf.intcount; j++)
+                    socket.intdata[j] = m_ints[m_intPos[i] + j].load(std::memory_order_relaxed);
+                for (uint8_t j = 0; j < conf.longcount; j++)
+                    socket.longdata[j] = m_longs[m_longPos[i] + j].load(std::memory_order_relaxed);
+                for (uint8_t j = 0; j < conf.realcount; j++)
+                    socket.realdata[j] = m_reals[m_realPos[i] + j].load(std::memory_order_relaxed);
+                socket.sender = m_sender[i].load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (m_seq[i].load(std::memory_order_relaxed) == seq)
+                {
+                    socket.config = conf;
+                    socket.socket_valid = true;
+                    if (version != NULL)
+                        *version = seq / 2;
+                    return true;
+                }
+            }
+            backoff(tries);
+        }
+    }
+    bool update(const char *frame, size_t len, const ab_header &header) override
+    {
+        bool retval = false;
+        for (uint8_t i = m_head[header.typ]; i != AB_MIRROR_NONE; i = m_next[i])
+        {
+            if ((m_nad[i] != 0 && m_nad[i] != header.from) || m_len[i] != header.len)
+                continue;
+            ab_socket_view view;
+            if (!ab_getSocketView(frame, len, header, m_config[i], view))
+                continue;
+            const ab_socket_config &conf = m_config[i];
+            // odd sequence = write in progress
+            uint32_t seq = m_seq[i].load(std::memory_order_relaxed);
+            m_seq[i].store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            for (uint8_t j = 0; j < conf.bitcount; j++)
+                m_bits[m_bitPos[i] + j].store(view.bit(j), std::memory_order_relaxed);
+            for (uint8_t j = 0; j < conf.intcount; j++)
+                m_ints[m_intPos[i] + j].store(view.i16(j), std::memory_order_relaxed);
+            for (uint8_t j = 0; j < conf.longcount; j++)
+                m_longs[m_longPos[i] + j].store(view.i32(j), std::memory_order_relaxed);
+            for (uint8_t j = 0; j < conf.realcount; j++)
+                m_reals[m_realPos[i] + j].store(view.real(j), std::memory_order_relaxed);
+            m_sender[i].store(header.from, std::memory_order_relaxed);
+            m_seq[i].store(seq + 2, std::memory_order_release);
+            retval = true;
+        }
+        return retval;
+    }
+
+private:
+    // registered sockets (struct of arrays, written by add() only)
+    std::atomic<uint8_t> m_count{0};
+    uint32_t m_nad[SOCKETS];
+    ab_socket_config m_config[SOCKETS];
+    uint16_t m_len[SOCKETS];                   // expected header length
+    uint16_t m_bitPos[SOCKETS];                // first tag of the socket in the value arrays
+    uint16_t m_intPos[SOCKETS];
+    uint16_t m_longPos[SOCKETS];
+    uint16_t m_realPos[SOCKETS];
+    uint8_t m_next[SOCKETS];                   // next socket with the same socket id (AB_MIRROR_NONE = end)
+    uint8_t m_head[256];                       // first socket per socket id (AB_MIRROR_NONE = none)
+    uint16_t m_bitUsed = 0;
+    uint16_t m_intUsed = 0;
+    uint16_t m_longUsed = 0;
+    uint16_t m_realUsed = 0;
+    // values (written by update())
+    std::atomic<uint32_t> m_seq[SOCKETS];      // sequence counter (odd = write in progress, 0 = nothing received)
+    // the values are relaxed atomics, they compile to plain loads and stores but keep the concurrent access defined
+    std::atomic<uint32_t> m_sender[SOCKETS];   // NAD of the last frame
+    std::atomic<uint8_t> m_bits[BITS > 0 ? BITS : 1];
+    std::atomic<int16_t> m_ints[INTS > 0 ? INTS : 1];
+    std::atomic<int32_t> m_longs[LONGS > 0 ? LONGS : 1];
+    std::atomic<float_t> m_reals[REALS > 0 ? REALS : 1];
+
+    bool valid(uint8_t handle) const
+    {
+        return handle > 0 && handle <= m_count.load(std::memory_order_acquire);
+    }
+    /**
+     * read one value of a socket consistent to its sequence counter
+     */
+    template <class T>
+    bool load(uint8_t i, const std::atomic<T> *src, T &value, uint32_t *version) const
+    {
+        for (uint16_t tries = 0;; tries++)
+        {
+            uint32_t seq = m_seq[i].load(std::memory_order_acquire);
+            if (seq == 0)
+                return false;
+            if ((seq & 1) == 0)
+            {
+                T copy = src->load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (m_seq[i].load(std::memory_order_relaxed) == seq)
+                {
+                    value = copy;
+                    if (version != NULL)
+                        *version = seq / 2;
+                    return true;
+                }
+            }
+            backoff(tries);
+        }
+    }
+    /**
+     * wait for the writer, a preempted writer on the same core needs the cpu to finish its frame
+     */
+    static void backoff(uint16_t tries)
+    {
+        if (tries >= 64)
+            delay(1);
+    }
+};
+
+#endif
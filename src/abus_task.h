@@ -0,0 +1,220 @@
+/**
+ * abus_task.h
+ * Purpose: worker task of abus_socket which sleeps until it is notified (FreeRTOS task on ESP32, std::thread on hosts)
+ * and the mutex which guards the state shared between loop() and the tasks
+ * there is no task support on the ESP8266, AB_TASK_SUPPORTED is not defined there
+
+ * @author Daniel Gangl
+ */
+#ifndef _ABUS_TASK_H_
+#define _ABUS_TASK_H_
+
+#include <abus_helper.h>
+
+#if defined(ESP32) || !defined(ARDUINO)
+#define AB_TASK_SUPPORTED 1
+#include <atomic>
+#if !defined(ARDUINO)
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+/**
+ * worker task which runs a function until stop() is called
+ * the function waits with wait() for notifications and returns when wait() returns false
+ * usage: void worker(void *arg) { while (task.wait(10)) { ... } }
+ */
+class ab_task
+{
+public:
+    typedef void (*function)(void *arg);
+    ~ab_task()
+    {
+        stop();
+    }
+    /**
+     * start the task
+     * @param fct task function
+     * @param arg argument of the task function
+     * @param name task name
+     * @param stackSize stack size in bytes (ESP32 only)
+     * @param priority task priority (ESP32 only)
+     * @param core cpu core of the task (ESP32 only, -1 = any core)
+     * @return true = task started, false = already running or no resources
+     */
+    bool start(function fct, void *arg, const char *name, uint32_t stackSize = 4096, uint8_t priority = 1, int core = -1)
+    {
+        if (m_run.load())
+            return false;
+        m_run = true;
+#if defined(ARDUINO)
+        m_done = false;
+        m_fct = fct;
+        m_arg = arg;
+        if (xTaskCreatePinnedToCore(trampoline, name, stackSize, this, priority, &m_handle, core < 0 ? tskNO_AFFINITY : core) != pdPASS)
+        {
+            m_handle = NULL;
+            m_done = true;
+            m_run = false;
+            return false;
+        }
+#else
+        (void)name;
+        (void)stackSize;
+        (void)priority;
+        (void)core;
+        m_notified = false;
+        m_thread = std::thread(fct, arg);
+#endif
+        return true;
+    }
+    /**
+     * stop the task and wait until the task function has returned (must not be called from the task itself)
+     */
+    void stop()
+    {
+        if (!m_run.load())
+            return;
+        m_run = false;
+        notify();
+#if defined(ARDUINO)
+        while (!m_done.load())
+            delay(1);
+        m_handle = NULL;
+#else
+        if (m_thread.joinable())
+            m_thread.join();
+#endif
+    }
+    /**
+     * @return true = task is running
+     */
+    bool running() const
+    {
+        return m_run.load();
+    }
+    /**
+     * wake up the task if it is waiting in wait()
+     */
+    void notify()
+    {
+#if defined(ARDUINO)
+        if (m_handle != NULL)
+            xTaskNotifyGive(m_handle);
+#else
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_notified = true;
+        }
+        m_cv.notify_one();
+#endif
+    }
+    /**
+     * task function: wait for a notification
+     * @param timeoutMs maximum waiting time in milliseconds
+     * @return true = continue, false = the task function has to return
+     */
+    bool wait(uint32_t timeoutMs)
+    {
+#if defined(ARDUINO)
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeoutMs));
+#else
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this]() { return m_notified || !m_run.load(); });
+        m_notified = false;
+#endif
+        return m_run.load();
+    }
+
+private:
+    std::atomic<bool> m_run{false}; // task shall run
+#if defined(ARDUINO)
+    TaskHandle_t m_handle = NULL;
+    std::atomic<bool> m_done{true}; // task function has returned
+    function m_fct = NULL;
+    void *m_arg = NULL;
+    static void trampoline(void *param)
+    {
+        ab_task *self = static_cast<ab_task *>(param);
+        self->m_fct(self->m_arg);
+        self->m_done = true;
+        vTaskDelete(NULL);
+    }
+#else
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_notified = false;
+#endif
+};
+
+/**
+ * mutex between loop() and the tasks (FreeRTOS mutex with priority inheritance on ESP32, std::mutex on hosts)
+ */
+class ab_mutex
+{
+public:
+#if defined(ARDUINO)
+    ab_mutex() : m_handle(xSemaphoreCreateMutex()) {}
+    ~ab_mutex()
+    {
+        if (m_handle != NULL)
+            vSemaphoreDelete(m_handle);
+    }
+    void lock()
+    {
+        if (m_handle != NULL)
+            xSemaphoreTake(m_handle, portMAX_DELAY);
+    }
+    void unlock()
+    {
+        if (m_handle != NULL)
+            xSemaphoreGive(m_handle);
+    }
+#else
+    ab_mutex() = default;
+    void lock()
+    {
+        m_mutex.lock();
+    }
+    void unlock()
+    {
+        m_mutex.unlock();
+    }
+#endif
+    ab_mutex(const ab_mutex &) = delete;
+    ab_mutex &operator=(const ab_mutex &) = delete;
+
+private:
+#if defined(ARDUINO)
+    SemaphoreHandle_t m_handle;
+#else
+    std::mutex m_mutex;
+#endif
+};
+
+/**
+ * holds an ab_mutex until the end of the scope
+ */
+class ab_lock
+{
+public:
+    explicit ab_lock(ab_mutex &mutex) : m_mutex(mutex)
+    {
+        m_mutex.lock();
+    }
+    ~ab_lock()
+    {
+        m_mutex.unlock();
+    }
+    ab_lock(const ab_lock &) = delete;
+    ab_lock &operator=(const ab_lock &) = delete;
+
+private:
+    ab_mutex &m_mutex;
+};
+#endif
+
+#endif
@@ -0,0 +1,227 @@
+/**
+ * abus_trace.h
+ * Purpose: binary event trace of abus_socket in a ring buffer, recording an event is a few stores,
+ * the events are formatted later by drain() outside of the time critical path
+
+ * @author Daniel Gangl
+ */
+#ifndef _ABUS_TRACE_H_
+#define _ABUS_TRACE_H_
+
+#include <abus_helper.h>
+#include <abus_task.h>
+#include <atomic>
+
+// kind of a trace event
+enum ab_trace_event : uint8_t
+{
+    AB_TRACE_RX = 0,       // socket frame received (result: 1 = passed to a callback, 0 = no callback)
+    AB_TRACE_RX_DROP = 1,  // invalid datagram dropped (result: ab_packet_check)
+    AB_TRACE_RX_OTHER = 2, // valid frame which is no socket (sock_id: typ, result: dir)
+    AB_TRACE_TX = 3,       // frame handed to the transport (result: ab_send_result, AB_SEND_OK or AB_SEND_FAILED)
+    AB_TRACE_TX_DROP = 4,  // frame dropped before the transport (result: ab_send_result)
+    AB_TRACE_RX_DUP = 5,   // socket frame dropped by its ts_id (result: ab_dedup_result)
+};
+
+// trace event
+struct ab_trace_entry
+{
+    uint32_t time;   // time stamp in us
+    uint32_t nad;    // sender NAD (rx) or destination NAD (tx)
+    uint16_t len;    // length of the datagram
+    uint8_t event;   // ab_trace_event
+    uint8_t sock_id; // socket id (typ of the frame)
+    uint8_t result;  // meaning depends on the event
+};
+
+// slot of the ring buffer, the fields are relaxed atomics (plain loads and stores) which are committed by seq
+struct ab_trace_slot
+{
+    std::atomic<uint32_t> seq{0}; // position of the event + 1, stored last (0 = empty)
+    std::atomic<uint32_t> time{0};
+    std::atomic<uint32_t> nad{0};
+    std::atomic<uint16_t> len{0};
+    std::atomic<uint8_t> event{0};
+    std::atomic<uint8_t> sock_id{0};
+    std::atomic<uint8_t> result{0};
+};
+
+/**
+ * ring buffer of trace events in a buffer of the caller, the oldest events are overwritten
+ * events can be recorded from the main loop, the receive task and the transmit task at the same time,
+ * drain() / read() have to be called from one place only, they stop at an event which is still being recorded
+ * and skip an event which is overwritten while it is copied (counted by lost())
+ * usage:
+ *   ab_trace_slot traceBuf[256];
+ *   ab_trace trace(traceBuf, 256);
+ *   abSock.setTrace(&trace);
+ *   ... trace.drain(Serial);
+ */
+class ab_trace
+{
+public:
+    /**
+     * constructor
+     * @param buffer event buffer, it has to outlive the trace
+     * @param count amount of events in the buffer (power of two)
+     */
+    ab_trace(ab_trace_slot *buffer, uint16_t count) : m_buf(count > 0 ? buffer : NULL)
+    {
+        // a size which is no power of two uses the largest power of two below it
+        uint32_t size = 1;
+        while (size * 2 <= count)
+            size *= 2;
+        m_mask = size - 1;
+    }
+    /**
+     * record an event
+     * @param event ab_trace_event
+     * @param sock_id socket id
+     * @param nad NAD
+     * @param len length of the datagram
+     * @param result meaning depends on the event
+     */
+    void record(uint8_t event, uint8_t sock_id, uint32_t nad, uint16_t len, uint8_t result)
+    {
+        if (m_buf == NULL)
+            return;
+        uint32_t pos = reserve();
+        ab_trace_slot &slot = m_buf[pos & m_mask];
+        // a reader which sees one of the following stores also sees the new head (see take())
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.time.store(micros(), std::memory_order_relaxed);
+        slot.nad.store(nad, std::memory_order_relaxed);
+        slot.len.store(len, std::memory_order_relaxed);
+        slot.event.store(event, std::memory_order_relaxed);
+        slot.sock_id.store(sock_id, std::memory_order_relaxed);
+        slot.result.store(result, std::memory_order_relaxed);
+        slot.seq.store(pos + 1, std::memory_order_release);
+    }
+    /**
+     * print the events which have been recorded since the last call, one line per event
+     * @param out output with printf(), e.g. Serial
+     * @param maxEvents maximum amount of printed events (0 = all)
+     * @return amount of printed events
+     */
+    template <class P>
+    uint16_t drain(P &out, uint16_t maxEvents = 0)
+    {
+        if (m_buf == NULL)
+            return 0;
+        static const char *const names[] = {"RX", "RX_DROP", "RX_OTHER", "TX", "TX_DROP", "RX_DUP"};
+        uint32_t head = m_head.load(std::memory_order_acquire);
+        // overwritten events are only counted
+        if (head - m_tail > m_mask + 1u)
+        {
+            m_lost += head - m_tail - (m_mask + 1u);
+            out.printf("*AB: trace lost %lu events\n", (unsigned long)(head - m_tail - (m_mask + 1u)));
+            m_tail = head - (m_mask + 1u);
+        }
+        uint16_t retval = 0;
+        ab_trace_entry entry;
+        while (m_tail != head && (maxEvents == 0 || retval < maxEvents))
+        {
+            int8_t taken = take(entry);
+            if (taken == 0)
+                break;
+            if (taken < 0)
+                continue;
+            out.printf("%10lu %-8s id=%3u nad=%10lu len=%3u res=%u\n", (unsigned long)entry.time,
+                       entry.event < sizeof(names) / sizeof(names[0]) ? names[entry.event] : "?", entry.sock_id,
+                       (unsigned long)entry.nad, entry.len, entry.result);
+            retval++;
+        }
+        return retval;
+    }
+    /**
+     * copy the events which have been recorded since the last call (binary alternative to drain())
+     * @param events receives the events
+     * @param maxEvents size of events
+     * @return amount of copied events
+     */
+    uint16_t read(ab_trace_entry *events, uint16_t maxEvents)
+    {
+        if (m_buf == NULL)
+            return 0;
+        uint32_t head = m_head.load(std::memory_order_acquire);
+        if (head - m_tail > m_mask + 1u)
+        {
+            m_lost += head - m_tail - (m_mask + 1u);
+            m_tail = head - (m_mask + 1u);
+        }
+        uint16_t retval = 0;
+        while (m_tail != head && retval < maxEvents)
+        {
+            int8_t taken = take(events[retval]);
+            if (taken == 0)
+                break;
+            if (taken > 0)
+                retval++;
+        }
+        return retval;
+    }
+    /**
+     * @return amount of events which have been overwritten before they were drained
+     */
+    uint32_t lost() const
+    {
+        return m_lost;
+    }
+
+private:
+    ab_trace_slot *m_buf;
+    uint32_t m_mask;                 // amount of events - 1
+    std::atomic<uint32_t> m_head{0}; // amount of recorded events
+    uint32_t m_tail = 0;             // amount of drained events
+    uint32_t m_lost = 0;             // overwritten events
+    // position of the next event
+    uint32_t reserve()
+    {
+#ifdef AB_TASK_SUPPORTED
+        // the transmit task records its events concurrently to the main loop
+        return m_head.fetch_add(1, std::memory_order_acq_rel);
+#else
+        // no tasks, only one writer (no atomic read-modify-write on the ESP8266)
+        uint32_t retval = m_head.load(std::memory_order_relaxed);
+        m_head.store(retval + 1, std::memory_order_release);
+        return retval;
+#endif
+    }
+    /**
+     * copy the event at the tail
+     * @param entry receives the event
+     * @return 1 = copied, 0 = still being recorded (tail unchanged), -1 = overwritten (skipped and counted as lost)
+     */
+    int8_t take(ab_trace_entry &entry)
+    {
+        const ab_trace_slot &slot = m_buf[m_tail & m_mask];
+        uint32_t seq = slot.seq.load(std::memory_order_acquire);
+        if (seq != m_tail + 1)
+        {
+            // an older stamp belongs to an event which is not committed yet, a newer one to an overwritten event
+            if ((int32_t)(seq - (m_tail + 1)) < 0)
+                return 0;
+            m_lost++;
+            m_tail++;
+            return -1;
+        }
+        entry.time = slot.time.load(std::memory_order_relaxed);
+        entry.nad = slot.nad.load(std::memory_order_relaxed);
+        entry.len = slot.len.load(std::memory_order_relaxed);
+        entry.event = slot.event.load(std::memory_order_relaxed);
+        entry.sock_id = slot.sock_id.load(std::memory_order_relaxed);
+        entry.result = slot.result.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        // a writer which has reserved the slot again may have changed the fields while they were copied
+        uint32_t head = m_head.load(std::memory_order_relaxed);
+        m_tail++;
+        if (head - (m_tail - 1) > m_mask + 1u)
+        {
+            m_lost++;
+            return -1;
+        }
+        return 1;
+    }
+};
+
+#endif
@@ -0,0 +1,231 @@
+/**
+ * abus_transport.h
+ * Purpose: udp transport interface of abus_socket and the default WiFiUDP implementation for ESP8266 / ESP32
+
+ * @author Daniel Gangl
+ */
+#ifndef _ABUS_TRANSPORT_H_
+#define _ABUS_TRANSPORT_H_
+
+#include <abus_helper.h>
+
+/**
+ * interface of the datagram transport which is used by abus_socket
+ * it follows the receive model of the Arduino UDP class: parsePacket() fetches the next datagram and read() copies it
+ */
+class ab_transport
+{
+public:
+    virtual ~ab_transport() {}
+    /**
+     * open the transport and listen on the given udp port
+     * @param localUdpPort local udp port
+     * @return true = successful
+     */
+    virtual bool begin(uint16_t localUdpPort) = 0;
+    /**
+     * close the transport
+     */
+    virtual void stop() = 0;
+    /**
+     * fetch the next received datagram, a not completely read datagram is discarded
+     * @return length of the datagram (0 = nothing received)
+     */
+    virtual int parsePacket() = 0;
+    /**
+     * fetch the next received datagram together with its sender, a not completely read datagram is discarded
+     * abus_socket receives with this one, a transport whose send() changes the sender of the current datagram
+     * overrides it and fetches both under the same lock as send() (the transmit task may send concurrently)
+     * @param ip receives the ip address of the sender
+     * @param port receives the udp port of the sender
+     * @return length of the datagram (0 = nothing received)
+     */
+    virtual int parsePacketFrom(uint32_t &ip, uint16_t &port)
+    {
+        int len = parsePacket();
+        ip = (uint32_t)remoteIP();
+        port = remotePort();
+        return len;
+    }
+    /**
+     * read data of the current datagram
+     * @param data pointer to data buffer
+     * @param len size of the data buffer
+     * @return amount of bytes read
+     */
+    virtual int read(char *data, size_t len) = 0;
+    /**
+     * wait until a datagram may have been received (used by the receive task of abus_socket)
+     * the default implementation sleeps one millisecond, transports with a blocking wait override it
+     * @param timeoutMs maximum waiting time in milliseconds
+     */
+    virtual void waitPacket(uint32_t timeoutMs)
+    {
+        (void)timeoutMs;
+        delay(1);
+    }
+    /**
+     * @return ip address of the sender of the current datagram (see parsePacketFrom())
+     */
+    virtual IPAddress remoteIP() = 0;
+    /**
+     * @return udp port of the sender of the current datagram
+     */
+    virtual uint16_t remotePort() = 0;
+    /**
+     * send a single datagram
+     * @param ip destination ip address
+     * @param port destination udp port
+     * @param data pointer to data buffer
+     * @param datalen amount of bytes to send
+     * @return true = successful
+     */
+    virtual bool send(const IPAddress &ip, uint16_t port, const char *data, size_t datalen) = 0;
+    /**
+     * buffer of the next datagram to send, frames can be encoded directly into it and sent with sendTxBuffer()
+     * the default is a buffer of the transport which send() copies into the driver; a transport whose driver
+     * exposes its packet buffer can return that one and send it in sendTxBuffer() without the copy
+     * @return pointer to the transmit buffer with txBufferSize() bytes
+     */
+    virtual char *txBuffer()
+    {
+        return m_txbuf;
+    }
+    /**
+     * @return size of the transmit buffer
+     */
+    virtual size_t txBufferSize() const
+    {
+        return sizeof(m_txbuf);
+    }
+    /**
+     * send the datagram in the transmit buffer
+     * @param ip destination ip address
+     * @param port destination udp port
+     * @param datalen amount of bytes in the transmit buffer
+     * @return true = successful
+     */
+    virtual bool sendTxBuffer(const IPAddress &ip, uint16_t port, size_t datalen)
+    {
+        return send(ip, port, txBuffer(), datalen);
+    }
+    /**
+     * @return broadcast address of the network the transport is connected to
+     */
+    virtual IPAddress broadcastIP() = 0;
+    /**
+     * @return default communication NAD of this device (derived from the mac address, 0 = unknown)
+     */
+    virtual uint32_t defaultNad() = 0;
+
+protected:
+    char m_txbuf[MAX_DATA_LEN]; // default transmit buffer
+};
+
+#if defined(ARDUINO)
+#if defined(ESP8266)
+#include <ESP8266WiFi.h>
+#elif defined(ESP32)
+#include <WiFi.h>
+#endif
+#include <WiFiUdp.h>
+
+/**
+ * default transport of abus_socket with the WiFiUDP driver of the ESP8266 / ESP32 core
+ * WiFiUDP does not expose its packet buffer, so a frame in txBuffer() is copied once by Udp.write()
+ * WiFiUDP keeps the sender of the current datagram and the destination of the packet in send in the same address,
+ * on the ESP32 parsePacket() and send() are serialized by a mutex because the tasks of abus_socket receive and send concurrently
+ */
+class ab_wifi_transport : public ab_transport
+{
+private:
+    WiFiUDP Udp; // wifi udp driver
+#if defined(ESP32)
+    SemaphoreHandle_t m_lock = xSemaphoreCreateMutex(); // serializes the access to the addresses of Udp
+#endif
+    void lock()
+    {
+#if defined(ESP32)
+        if (m_lock != NULL)
+            xSemaphoreTake(m_lock, portMAX_DELAY);
+#endif
+    }
+    void unlock()
+    {
+#if defined(ESP32)
+        if (m_lock != NULL)
+            xSemaphoreGive(m_lock);
+#endif
+    }
+
+public:
+#if defined(ESP32)
+    ~ab_wifi_transport()
+    {
+        if (m_lock != NULL)
+            vSemaphoreDelete(m_lock);
+    }
+#endif
+    bool begin(uint16_t localUdpPort)
+    {
+        return Udp.begin(localUdpPort) == 1;
+    }
+    void stop()
+    {
+        Udp.stop();
+    }
+    int parsePacket()
+    {
+        lock();
+        int len = Udp.parsePacket();
+        unlock();
+        return len;
+    }
+    int parsePacketFrom(uint32_t &ip, uint16_t &port)
+    {
+        lock();
+        int len = Udp.parsePacket();
+        ip = (uint32_t)Udp.remoteIP();
+        port = Udp.remotePort();
+        unlock();
+        return len;
+    }
+    int read(char *data, size_t len)
+    {
+        return Udp.read(data, len);
+    }
+    IPAddress remoteIP()
+    {
+        return Udp.remoteIP();
+    }
+    uint16_t remotePort()
+    {
+        return Udp.remotePort();
+    }
+    bool send(const IPAddress &ip, uint16_t port, const char *data, size_t datalen)
+    {
+        lock();
+        bool retval = Udp.beginPacket(ip, port) &&
+                      // one bulk copy into the packet buffer of the driver
+                      Udp.write(reinterpret_cast<const uint8_t *>(data), datalen) == datalen && Udp.endPacket();
+        unlock();
+        return retval;
+    }
+    IPAddress broadcastIP()
+    {
+#if defined(ESP8266)
+        return WiFi.localIP().v4() | ~WiFi.subnetMask().v4();
+#else
+        return WiFi.localIP() | ~WiFi.subnetMask();
+#endif
+    }
+    uint32_t defaultNad()
+    {
+        char mac[12];
+        WiFi.macAddress().toCharArray(mac, sizeof(mac), 0);
+        return mac[0] | mac[1] << 8L | mac[2] << 16L | mac[3] << 24L;
+    }
+};
+#endif
+
+#endif
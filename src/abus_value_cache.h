@@ -0,0 +1,121 @@
+/**
+ * abus_value_cache.h
+ * Purpose: cache of PLC variable values with their read time, answers repeated reads within a time to live locally
+
+ * @author Daniel Gangl
+ */
+#ifndef _ABUS_VALUE_CACHE_H_
+#define _ABUS_VALUE_CACHE_H_
+
+#include <abus_helper.h>
+
+// cache entry of a variable
+struct ab_value_entry
+{
+    uint32_t nad = 0;   // NAD of the PLC (0 = free entry)
+    uint16_t addr = 0;  // memory address of the variable
+    uint8_t type = 0;   // ab_var_type of the stored value
+    uint32_t raw = 0;   // value bits (int / long sign extended, real as float bits)
+    uint32_t time = 0;  // time of the read / write in ms
+};
+
+/**
+ * fixed size (NAD, address) -> value cache without heap allocation
+ * the entries are organized in buckets of 4 entries (set associative hash), a full bucket replaces its oldest entry
+ * the time to live is given by the reader, so every tag can use its own one
+ * @param N amount of entries (power of two, at least 4)
+ */
+template <uint16_t N>
+class ab_value_cache
+{
+    static_assert(N >= 4 && (N & (N - 1)) == 0, "ab_value_cache size must be a power of two and at least 4");
+
+public:
+    static constexpr uint16_t ways = 4; // entries per bucket
+    /**
+     * add or update a value
+     * @param nad NAD of the PLC
+     * @param addr memory address of the variable
+     * @param type ab_var_type of the value
+     * @param raw value bits
+     * @param now current time in ms
+     */
+    void store(uint32_t nad, uint16_t addr, uint8_t type, uint32_t raw, uint32_t now)
+    {
+        if (nad == 0)
+            return;
+        ab_value_entry *bucket = m_entries + bucketPos(nad, addr);
+        ab_value_entry *victim = &bucket[0];
+        for (uint16_t i = 0; i < ways; i++)
+        {
+            if (bucket[i].nad == nad && bucket[i].addr == addr)
+            {
+                victim = &bucket[i];
+                break;
+            }
+            // a free entry is used before the oldest one
+            if (victim->nad != 0 && (bucket[i].nad == 0 || (int32_t)(bucket[i].time - victim->time) < 0))
+                victim = &bucket[i];
+        }
+        victim->nad = nad;
+        victim->addr = addr;
+        victim->type = type;
+        victim->raw = raw;
+        victim->time = now;
+    }
+    /**
+     * get a value which is not older than maxAgeMs
+     * @param nad NAD of the PLC
+     * @param addr memory address of the variable
+     * @param type expected ab_var_type (a value of a different type is not used)
+     * @param maxAgeMs time to live of the value in ms
+     * @param now current time in ms
+     * @param raw receives the value bits
+     * @return true = valid value found
+     */
+    bool lookup(uint32_t nad, uint16_t addr, uint8_t type, uint16_t maxAgeMs, uint32_t now, uint32_t &raw) const
+    {
+        const ab_value_entry *entry = find(nad, addr);
+        if (entry == NULL || entry->type != type || (uint32_t)(now - entry->time) > maxAgeMs)
+            return false;
+        raw = entry->raw;
+        return true;
+    }
+    /**
+     * remove all values of a PLC
+     * @param nad NAD of the PLC (0 = all values)
+     */
+    void invalidate(uint32_t nad)
+    {
+        for (uint16_t i = 0; i < N; i++)
+        {
+            if (nad == 0 || m_entries[i].nad == nad)
+                m_entries[i] = ab_value_entry();
+        }
+    }
+
+private:
+    ab_value_entry m_entries[N];
+    /**
+     * @return position of the first entry of the bucket of the variable
+     */
+    static uint16_t bucketPos(uint32_t nad, uint16_t addr)
+    {
+        // multiplicative hash, the addresses of a PLC program are mostly consecutive
+        return (uint16_t)((((nad ^ ((uint32_t)addr << 16 | addr)) * 0x9E3779B1u) >> 16) & (N / ways - 1)) * ways;
+    }
+    const ab_value_entry *find(uint32_t nad, uint16_t addr) const
+    {
+        if (nad == 0)
+            return NULL;
+        const ab_value_entry *bucket = m_entries + bucketPos(nad, addr);
+        for (uint16_t i = 0; i < ways; i++)
+        {
+            if (bucket[i].nad == nad && bucket[i].addr == addr)
+                return &bucket[i];
+        }
+        return NULL;
+    }
+};
+
+#endif